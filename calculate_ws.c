@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "perf_counters.h"
+#include "sketch.h"
+
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
 
@@ -14,6 +17,14 @@ typedef struct
     int pagesz, interval;
     const char * algorithm, * initialorder;
     int numelem;
+    char perf;              // Read the hardware counters
+    char sliding;           // W(t,interval) after every reference
+    int step;               // ...shown every 'step' references
+    char stream;            // Fixed-memory estimates (sketch.h)
+    int hllbits;            // ...2^hllbits HyperLogLog registers
+    int top;                // ...most referenced pages kept
+    int sample;             // ...pages in the popularity sample
+    char check;             // ...compared with exact counts
 }
 sparameters;
 
@@ -33,6 +44,8 @@ typedef struct
     char * prefbits;      // Reference bits of the pages
     int numbytes;         // Size in bytes
     unsigned numpages;    // # of pages (and ref. bits)
+    unsigned * ptouched;  // Pages referenced in current interval
+    unsigned numtouched;  // ...and how many (bits set)
     unsigned numrefs;     // # of references in current interval
     unsigned totalrefs;   // Total # of references
     unsigned numillegal;  // # of illegal references
@@ -41,7 +54,7 @@ spgstate;
 
 // Functions that manipulate the referenced pages set
 
-int reserve_bits (spgstate *, int numpages);
+int reserve_bits (spgstate *, int numpages, int interval);
 void free_bits (spgstate *);
 
 void annotate_reference (const sparameters *,
@@ -51,6 +64,68 @@ void annotate_reference (const sparameters *,
 void dump_num_refs (spgstate *);
 void print_header (void);
 
+// Sliding window: the working set W(t,tau) of Denning, the pages
+// referenced in the last tau references, after every reference.
+// The pages of the window are kept in a doubly linked list in the
+// order of their last references, so that the pages that leave
+// the window are always at its head
+
+typedef struct
+{
+    unsigned * plast;     // Last reference to each page (1..)
+    int * pprev, * pnext; // List of the pages in the window
+    int head, tail;       // Oldest and newest (-1 = empty)
+    unsigned numpages;    // # of pages
+    unsigned size;        // Pages in the window
+    unsigned time;        // # of references so far
+    unsigned tau, step;   // Window and output period
+    double sum;           // Sum of the sizes since last output
+    unsigned numillegal;  // # of illegal references
+}
+swindow;
+
+int reserve_window (swindow *, int numpages, int tau, int step);
+void free_window (swindow *);
+
+void window_reference (const sparameters *,
+                       swindow *,
+                       unsigned element);
+
+void dump_window (swindow *);
+void print_window_header (void);
+
+// Streaming mode: the memory doesn't depend on the number of
+// pages, so that traces of any size can be summarized. The pages
+// of each interval and of the whole trace are counted with
+// HyperLogLog, the most referenced pages with SpaceSaving, and
+// the distribution of the references per page comes from a
+// sample of the pages
+
+typedef struct
+{
+    shll interval, all;   // Different pages (interval, trace)
+    sspacesaving top;     // Most referenced pages
+    spopularity popular;  // References of the sampled pages
+    unsigned numpages;    // # of pages (only to find illegal ones)
+    unsigned numrefs;     // # of references in current interval
+    unsigned totalrefs;   // Total # of references
+    unsigned numillegal;  // # of illegal references
+    unsigned * exact;     // References of each page (--check)
+}
+sstream;
+
+int reserve_stream (sstream *, const sparameters *, int numpages);
+void free_stream (sstream *);
+
+void stream_reference (const sparameters *,
+                       sstream *,
+                       unsigned element);
+
+void dump_stream (sstream *);
+void print_stream_header (void);
+void print_stream_summary (sstream *, const sparameters *);
+int check_stream (sstream *);
+
 // Main function
 
 int main (int argc, char * argv[])
@@ -64,8 +139,15 @@ int main (int argc, char * argv[])
     spgstate S;         // State of the pages (referenced/not)
     unsigned numpags;   // Total number of pages
     unsigned totelem;   // Total num. of elements (double in MER)
+    sperfcounters C;    // Hardware counters (if P.perf)
+    swindow W;          // Sliding window (if P.sliding)
+    sstream R;          // Sketches (if P.stream)
 
     S.prefbits = NULL;
+    S.ptouched = NULL;
+    W.plast = NULL;
+    W.pprev = W.pnext = NULL;
+    memset (&R, 0, sizeof(R));
 
     if (parse_command(argc,argv,&P)<0)  // Put parameters in P
         return -1;
@@ -99,8 +181,13 @@ int main (int argc, char * argv[])
         // Calculate total number of pages
         numpags = (totelem+P.pagesz-1) / P.pagesz; 
 
-        // Reserve space for the reference bits
-        if (reserve_bits(&S,numpags)<0)
+        // Reserve space for the reference bits (or the window,
+        // or the sketches)
+        if (P.sliding ?
+            reserve_window(&W,numpags,P.interval,P.step)<0 :
+            P.stream ?
+            reserve_stream(&R,&P,numpags)<0 :
+            reserve_bits(&S,numpags,P.interval)<0)
         {
             fprintf (stderr,
                      "ERROR: not enough "
@@ -109,9 +196,19 @@ int main (int argc, char * argv[])
         }
     }
 
-    if (ok)
+    if (ok && P.sliding)
+        print_window_header ();
+    else if (ok && P.stream)
+        print_stream_header ();
+    else if (ok)
         print_header ();
 
+    if (P.perf)
+    {
+        perf_open (&C);
+        perf_start (&C);
+    }
+
     while (ok)
     {
         // Ignore spaces and read one character
@@ -125,6 +222,10 @@ int main (int argc, char * argv[])
         {                                    // take element
             if (fscanf(pipe,"%u",&u)!=1)     // number and
                 ok = 0;                      // annotate
+            else if (P.sliding)
+                window_reference (&P, &W, u);
+            else if (P.stream)
+                stream_reference (&P, &R, u);
             else
                 annotate_reference (&P, &S, u);
         }
@@ -134,13 +235,43 @@ int main (int argc, char * argv[])
             ok = 0;              // something else) -> error
     }
 
-    if (ok)
+    if (P.perf)
+        perf_stop (&C);
+
+    if (ok && P.sliding)
     {
+        // The last (partial) step
+        if (W.time % W.step)
+            dump_window (&W);
+
+        S.totalrefs = W.time;
+        S.numillegal = W.numillegal;
+    }
+    else if (ok && P.stream)
+    {
+        dump_stream (&R);
+        print_stream_summary (&R, &P);
+
+        if (P.check && check_stream(&R)<0)
+            ok = 0;
+
+        S.totalrefs = R.totalrefs;
+        S.numillegal = R.numillegal;
+    }
+    else if (ok)
         dump_num_refs (&S);
 
+    if (ok)
+    {
         if (S.numillegal)
             printf ("WARNING: There were %u references to "
                              "nonexistent pages\n", S.numillegal);
+
+        if (P.perf)
+        {
+            printf ("#\n");
+            perf_print (&C, S.totalrefs + S.numillegal);
+        }
     }
 
     // Wait until gen_trace ends and close
@@ -148,20 +279,32 @@ int main (int argc, char * argv[])
         ok = 0;
 
     free_bits (&S);
+    free_window (&W);
+
+    if (P.stream)
+        free_stream (&R);
 
     return ok ? 0 : -1;
 }
 
 // Functions that manipulate the referenced pages set
 
-int reserve_bits (spgstate * pS, int numpages)
+// Besides the bits, the pages referenced in each interval are
+// kept in a list (there can't be more than the references of an
+// interval), so that counting them and clearing their bits costs
+// as much as the pages touched, not as all the pages
+
+int reserve_bits (spgstate * pS, int numpages, int interval)
 {
     pS->numpages = numpages;
     pS->numbytes = NUM_BYTES (numpages);
     pS->numrefs = pS->totalrefs = pS->numillegal = 0;
+    pS->numtouched = 0;
     pS->prefbits = (char*) malloc (pS->numbytes);
+    pS->ptouched = (unsigned*) malloc ((interval<numpages ? interval :
+                                        numpages)*sizeof(unsigned));
 
-    if (pS->prefbits)
+    if (pS->prefbits && pS->ptouched)
     {
         memset (pS->prefbits, 0, pS->numbytes);
         return 0;
@@ -173,7 +316,9 @@ int reserve_bits (spgstate * pS, int numpages)
 void free_bits (spgstate * pS)
 {
     free (pS->prefbits);
+    free (pS->ptouched);
     pS->prefbits = NULL;
+    pS->ptouched = NULL;
 }
 
 void annotate_reference (const sparameters * pPar,
@@ -186,7 +331,11 @@ void annotate_reference (const sparameters * pPar,
 
     if (page < pS->numpages)
     {
-        SET_BIT (pS->prefbits, page);
+        if (!GET_BIT(pS->prefbits, page))
+        {
+            SET_BIT (pS->prefbits, page);
+            pS->ptouched[pS->numtouched++] = page;
+        }
 
         if (++pS->numrefs >= pPar->interval)
             dump_num_refs (pS);
@@ -203,24 +352,315 @@ void print_header (void)
 
 void dump_num_refs (spgstate * pS)
 {
-    unsigned u, refs;
+    unsigned u, refs = pS->numtouched;
 
     if (!pS->numrefs)
         return;
 
-    for (u=refs=0; u<pS->numpages; u++)
-        if (GET_BIT(pS->prefbits, u))
-            refs ++;
-
     printf (" %15u %15u %15u %15f\n",
             pS->totalrefs, pS->numrefs,
             refs, refs/(float)pS->numrefs);
 
-    memset (pS->prefbits, 0, pS->numbytes);
+    // Clear only the bytes with bits set
+    for (u=0; u<pS->numtouched; u++)
+        pS->prefbits[pS->ptouched[u]>>3] = 0;
+
+    pS->numtouched = 0;
     pS->totalrefs += pS->numrefs;
     pS->numrefs = 0;
 }
 
+// Functions of the sliding window
+
+int reserve_window (swindow * pW, int numpages, int tau, int step)
+{
+    pW->numpages = numpages;
+    pW->head = pW->tail = -1;
+    pW->size = pW->time = pW->numillegal = 0;
+    pW->tau = tau;
+    pW->step = step ? step : tau;
+    pW->sum = 0;
+    pW->plast = (unsigned*) calloc (numpages, sizeof(unsigned));
+    pW->pprev = (int*) malloc (numpages*sizeof(int));
+    pW->pnext = (int*) malloc (numpages*sizeof(int));
+
+    return pW->plast && pW->pprev && pW->pnext ? 0 : -1;
+}
+
+void free_window (swindow * pW)
+{
+    free (pW->plast);
+    free (pW->pprev);
+    free (pW->pnext);
+    pW->plast = NULL;
+    pW->pprev = pW->pnext = NULL;
+}
+
+static void unlink_page (swindow * pW, int page)
+{
+    if (pW->pprev[page]!=-1)
+        pW->pnext[pW->pprev[page]] = pW->pnext[page];
+    else
+        pW->head = pW->pnext[page];
+
+    if (pW->pnext[page]!=-1)
+        pW->pprev[pW->pnext[page]] = pW->pprev[page];
+    else
+        pW->tail = pW->pprev[page];
+
+    pW->size --;
+}
+
+void window_reference (const sparameters * pPar,
+                       swindow * pW,
+                       unsigned element)
+{
+    unsigned page;
+
+    page = element / pPar->pagesz;
+
+    if (page >= pW->numpages)
+    {
+        pW->numillegal ++;
+        return;
+    }
+
+    pW->time ++;
+
+    // The page goes to the tail of the list (newest)
+    if (pW->plast[page] && pW->plast[page] + pW->tau > pW->time - 1)
+        unlink_page (pW, page);
+
+    pW->plast[page] = pW->time;
+    pW->pprev[page] = pW->tail;
+    pW->pnext[page] = -1;
+
+    if (pW->tail!=-1)
+        pW->pnext[pW->tail] = page;
+    else
+        pW->head = page;
+
+    pW->tail = page;
+    pW->size ++;
+
+    // Pages not referenced in the last tau references leave
+    while (pW->plast[pW->head] + pW->tau <= pW->time)
+        unlink_page (pW, pW->head);
+
+    pW->sum += pW->size;
+
+    if (pW->time % pW->step == 0)
+        dump_window (pW);
+}
+
+void print_window_header (void)
+{
+    printf ("#\n#%18s %15s %15s %15s\n#\n",
+            "Position", "Window", "Pages", "Average");
+}
+
+void dump_window (swindow * pW)
+{
+    unsigned n = pW->time % pW->step ? pW->time % pW->step : pW->step;
+
+    printf (" %15u %15u %15u %15f\n",
+            pW->time, pW->tau, pW->size, pW->sum/n);
+
+    pW->sum = 0;
+}
+
+// Functions of the streaming mode
+
+int reserve_stream (sstream * pR, const sparameters * pPar, int numpages)
+{
+    pR->numpages = numpages;
+    pR->numrefs = pR->totalrefs = pR->numillegal = 0;
+    pR->exact = NULL;
+
+    if (pPar->check &&
+        !(pR->exact = (unsigned*) calloc (numpages, sizeof(unsigned))))
+        return -1;
+
+    return hll_init (&pR->interval, pPar->hllbits) < 0 ||
+           hll_init (&pR->all, pPar->hllbits) < 0 ||
+           spacesaving_init (&pR->top, pPar->top) < 0 ||
+           popularity_init (&pR->popular, pPar->sample) < 0 ? -1 : 0;
+}
+
+void free_stream (sstream * pR)
+{
+    hll_free (&pR->interval);
+    hll_free (&pR->all);
+    spacesaving_free (&pR->top);
+    popularity_free (&pR->popular);
+    free (pR->exact);
+}
+
+// Bytes taken by the sketches (the same for any trace)
+
+static unsigned long stream_bytes (const sstream * pR)
+{
+    const sspacesaving * pS = &pR->top;
+    const spopularity * pU = &pR->popular;
+
+    return (2ul << pR->interval.p) +
+           (unsigned long) pS->k * (sizeof(unsigned) +
+                                    2*sizeof(unsigned long long) +
+                                    2*sizeof(int)) +
+           (unsigned long) pS->map.size * (sizeof(unsigned)+sizeof(int)) +
+           (unsigned long) (pU->maxpages+1) * (sizeof(unsigned) +
+                                               sizeof(unsigned long long) +
+                                               3*sizeof(int)) +
+           (unsigned long) pU->map.size * (sizeof(unsigned)+sizeof(int));
+}
+
+void stream_reference (const sparameters * pPar,
+                       sstream * pR,
+                       unsigned element)
+{
+    unsigned page;
+
+    page = element / pPar->pagesz;
+
+    if (page >= pR->numpages)
+    {
+        pR->numillegal ++;
+        return;
+    }
+
+    hll_add (&pR->interval, page);
+    hll_add (&pR->all, page);
+    spacesaving_add (&pR->top, page);
+    popularity_add (&pR->popular, page);
+
+    if (pR->exact)
+        pR->exact[page] ++;
+
+    if (++pR->numrefs >= pPar->interval)
+        dump_stream (pR);
+}
+
+void print_stream_header (void)
+{
+    printf ("#\n#%18s %15s %15s %15s %15s\n#\n",
+            "Position", "Interval", "Pages (est.)", "+/-", "Pages/op.");
+}
+
+void dump_stream (sstream * pR)
+{
+    double e;
+
+    if (!pR->numrefs)
+        return;
+
+    e = hll_estimate (&pR->interval);
+
+    printf (" %15u %15u %15.0f %15.0f %15f\n",
+            pR->totalrefs, pR->numrefs, e,
+            e*hll_error(&pR->interval), e/pR->numrefs);
+
+    hll_reset (&pR->interval);
+    pR->totalrefs += pR->numrefs;
+    pR->numrefs = 0;
+}
+
+void print_stream_summary (sstream * pR, const sparameters * pPar)
+{
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 1 };
+    sspacesaving * pS = &pR->top;
+    spopularity * pU = &pR->popular;
+    int * order, i, n;
+    double e = hll_estimate (&pR->all);
+
+    printf ("#\n# Pages referenced (est.): %.0f +/- %.0f "
+            "(standard error %.2f%%)\n",
+            e, e*hll_error(&pR->all), 100*hll_error(&pR->all));
+
+    // Most referenced pages: the true count of each one is between
+    // count-error and count, and no page out of the list has more
+    // than total/k references
+    order = (int*) malloc (pS->k*sizeof(int));
+
+    if (order)
+    {
+        n = spacesaving_top (pS, order);
+
+        printf ("#\n# Most referenced pages (any page with more than "
+                "%llu references is here)\n#\n#%14s %15s %15s\n",
+                pS->total/pS->k, "Page", "References", "At least");
+
+        for (i=0; i<n; i++)
+            printf ("#%14u %15llu %15llu\n", pS->page[order[i]],
+                    pS->count[order[i]],
+                    pS->count[order[i]]-pS->error[order[i]]);
+
+        free (order);
+    }
+
+    // Quantiles of the references per page, from the sample
+    printf ("#\n# References per page, from %d sampled pages "
+            "(rate %.4f)\n# Quantiles within +/- %.2f%% of the pages "
+            "with 95%% confidence\n#\n#%14s %15s\n",
+            pU->numpages, sample_rate(&pU->A),
+            100*popularity_error(pU,0.95), "Quantile", "References");
+
+    for (i=0; i<(int)(sizeof(quantiles)/sizeof(*quantiles)); i++)
+        printf ("#%13.0f%% %15llu\n", 100*quantiles[i],
+                popularity_quantile(pU,quantiles[i]));
+
+    printf ("#\n# Memory of the sketches: %lu bytes\n", stream_bytes(pR));
+}
+
+// Function that compares the sketches with the exact counts of
+// every page (--check). What SpaceSaving guarantees must hold
+// always: the true count of a page of the list is between
+// count-error and count, and every page with more than total/k
+// references is in the list. HyperLogLog is only expected to be
+// within a few standard errors. Returns 0 if OK
+
+int check_stream (sstream * pR)
+{
+    sspacesaving * pS = &pR->top;
+    unsigned long long t, threshold = pS->total/pS->k;
+    unsigned p, distinct = 0;
+    int c, wrong = 0;
+    double e = hll_estimate (&pR->all);
+
+    for (c=0; c<pS->used; c++)
+    {
+        t = pR->exact[pS->page[c]];
+
+        if (t > pS->count[c] || t < pS->count[c]-pS->error[c])
+        {
+            printf ("# ERROR: page %u has %llu references, not "
+                    "%llu-%llu\n", pS->page[c], t,
+                    pS->count[c]-pS->error[c], pS->count[c]);
+            wrong ++;
+        }
+    }
+
+    for (p=0; p<pR->numpages; p++)
+    {
+        distinct += pR->exact[p]!=0;
+
+        if (pR->exact[p] > threshold &&
+            keymap_get(&pS->map,p)==-1)
+        {
+            printf ("# ERROR: page %u has %u references and is not "
+                    "in the list\n", p, pR->exact[p]);
+            wrong ++;
+        }
+    }
+
+    printf ("#\n# Check against the exact counts\n"
+            "# Pages referenced:  %u (estimate off by %.2f standard "
+            "errors)\n# Most referenced:   %s\n", distinct,
+            distinct ? (e-distinct)/(distinct*hll_error(&pR->all)) : 0.0,
+            wrong ? "WRONG" : "OK");
+
+    return wrong ? -1 : 0;
+}
+
 // Function that parses the parameters received through the
 // command line:
 
@@ -229,7 +669,7 @@ void dump_num_refs (spgstate * pS)
 
 int parse_command (int argc, char * argv[], sparameters * p)
 {
-    int ok;
+    int ok, i, n;
 
     // Default parameters
     p->pagesz = 16;
@@ -237,13 +677,65 @@ int parse_command (int argc, char * argv[], sparameters * p)
     p->algorithm = "MER";
     p->initialorder = "RAN";
     p->numelem = 1000;
+    p->perf = 0;
+    p->sliding = 0;
+    p->step = 0;
+    p->stream = 0;
+    p->hllbits = 12;
+    p->top = 32;
+    p->sample = 4096;
+    p->check = 0;
+
+    // Take the options out of argv, so that the remaining
+    // parameters keep their positions
+    for (i=n=1, ok=1; i<argc; i++)
+        if (!strcmp(argv[i],"--perf"))
+            p->perf = 1;
+        else if (!strcmp(argv[i],"--sliding"))
+            p->sliding = 1;
+        else if (!strncmp(argv[i],"--step=",7))
+        {
+            if (sscanf(argv[i]+7,"%d",&p->step)!=1 || p->step<1)
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong value in %s\n", argv[i]);
+                ok = 0;
+            }
+        }
+        else if (!strcmp(argv[i],"--stream"))
+            p->stream = 1;
+        else if (!strcmp(argv[i],"--check"))
+            p->check = 1;
+        else if (!strncmp(argv[i],"--hll=",6) ||
+                 !strncmp(argv[i],"--top=",6) ||
+                 !strncmp(argv[i],"--sample=",9))
+        {
+            int * v = argv[i][2]=='h' ? &p->hllbits :
+                      argv[i][2]=='t' ? &p->top : &p->sample;
+
+            if (sscanf(strchr(argv[i],'=')+1,"%d",v)!=1 || *v<1 ||
+                (v==&p->hllbits && (*v<4 || *v>20)))
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong value in %s\n", argv[i]);
+                ok = 0;
+            }
+        }
+        else if (!strncmp(argv[i],"--",2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: unknown option %s\n", argv[i]);
+            ok = 0;
+        }
+        else
+            argv[n++] = argv[i];
+
+    argc = n;
 
     if (argc>6)
         ok = 0;
     else
     {
-        ok = 1;
-
         if (argc>1 && (sscanf(argv[1],"%d",&p->pagesz)!=1 ||
                        p->pagesz<1))
         {
@@ -308,14 +800,36 @@ int parse_command (int argc, char * argv[], sparameters * p)
              "\talgorithm: sorting algorithm (%s)\n"
              "\tinitialorder: initial order of the array (%s)\n"
              "\tnumelem: # of elements to be sorted\n"
+             "\n"
+             "    OPTIONS:\n"
+             "\t--perf: read the hardware counters (cycles,\n"
+             "\t        instructions, LLC and branch misses)\n"
+             "\t        of the main loop\n"
+             "\t--sliding: working set of the last 'interval'\n"
+             "\t        references, after every reference\n"
+             "\t--step=N: with --sliding, show it every N\n"
+             "\t        references (interval)\n"
+             "\t--stream: estimate the pages of each interval in\n"
+             "\t        a fixed amount of memory, and show the most\n"
+             "\t        referenced pages and the distribution of\n"
+             "\t        the references per page\n"
+             "\t--hll=P: with --stream, 2^P registers to count\n"
+             "\t        the pages, 4..20 (12, error 1.6%%)\n"
+             "\t--top=K: with --stream, pages in the list of the\n"
+             "\t        most referenced ones (32)\n"
+             "\t--sample=N: with --stream, pages sampled for the\n"
+             "\t        distribution (4096)\n"
+             "\t--check: with --stream, count the references of\n"
+             "\t        every page too, and check the estimates\n"
              "\n",
              VALID_ALGORITHMS, VALID_INITIAL_ORD);
 
     fprintf (stderr,
-             "    EXAMPLE:\n"
+             "    EXAMPLES:\n"
              "\t%s 16 2000 MER RAN 1000\n"
+             "\t%s 1 10000 QUI RAN 10000 --stream\n"
              "\n",
-             argv[0]);
+             argv[0], argv[0]);
 
     return -1;
 }
@@ -4,132 +4,689 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "sort.h"
+
+// Counts the operations (reads, writes and comparisons) of the
+// traces of gen_trace, for each sorting algorithm, initial state
+// and size of the array. Instead of reading the traces, the
+// algorithms of sort.c run in this process with callbacks that
+// only count, and the cells of the tables are shared out among
+// several threads. Every cell counted is added to a CSV file,
+// keyed by algorithm, initial state and size, and the cells
+// already in the file are not counted again
 
 #define NUM_ALG 8
 #define NUM_INI 3
-#define NUM_SZS 3
+#define MAX_SZS 32
+
+// Sorting algorithms: bubble, insertion, selection,
+// heapsort, combsort, mergesort, quicksort, and
+// quicksort with random pivot
+static const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
+                                            "HEA", "COM", "MER",
+                                            "QUI", "QRP" };
+
+static function_sort * sorts[NUM_ALG] = { bubble_sort, insertion_sort,
+                                           selection_sort, heap_sort,
+                                           comb_sort, merge_sort,
+                                           quick_sort, quick_sort_pa };
+
+// Initial states of the array: ASCending order,
+// DEScending order and RANdom order (or rather disorder)
+static const char * initial[NUM_INI] = { "ASC", "DES", "RAN" };
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    int numalg, numini, numsizes;
+    int alg[NUM_ALG], ini[NUM_INI];
+    unsigned sizes[MAX_SZS];
+    const char * dbfile;    // Results of previous runs
+    int threads;
+    char fit;               // Fit operations = C * size^k
+    unsigned predict;       // ...and predict them for this size
+}
+sparameters;
+
+// Counters of one sort (the first parameter of the callbacks)
+
+typedef struct
+{
+    thing * pdata;
+    unsigned long long nreads, nwrites, ncomparisons;
+}
+scontrol;
+
+// One cell of the tables
+
+typedef struct
+{
+    int a, i;               // Algorithm and initial state
+    unsigned size;
+    char done;              // Counted (or read from the file)
+    unsigned long long total;   // Operations (0 = error)
+}
+scell;
+
+// Cells to be counted by the threads
+
+typedef struct
+{
+    scell ** pending;       // Largest first
+    int numpending, next;
+    FILE * db;              // Where the results are added
+    int errors;
+    pthread_mutex_t lock;   // Of next, db and errors
+}
+spool;
+
+// quick_sort_pa takes its pivots from rand(), so the cells of
+// QRP are counted one at a time
+
+static pthread_mutex_t rand_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+int read_db (const char *, scell [], int);
+void * worker_thread (void *);
+void print_tables (const sparameters *, const scell []);
+void print_fit (const sparameters *, const scell []);
+
+// Callbacks of the sorting algorithms
+
+static thing count_read (void * p, unsigned pos)
+{
+    scontrol * pc = (scontrol*) p;
+
+    pc->nreads ++;
+    return pc->pdata[pos];
+}
+
+static void count_write (void * p, unsigned pos, thing value)
+{
+    scontrol * pc = (scontrol*) p;
+
+    pc->nwrites ++;
+    pc->pdata[pos] = value;
+}
+
+static int count_lesser_than (void * p, thing a, thing b)
+{
+    ((scontrol*) p)->ncomparisons ++;
+    return a < b;
+}
+
+// The same data as gen_trace: 0..size-1 in ascending order, in
+// descending order, or shuffled from the same seed. The numbers
+// come from rand() (R is NULL) or from R, which starts in the same
+// state but belongs to the thread
+
+static int next_random (struct random_data * R)
+{
+    int32_t n;
+
+    if (!R)
+        return rand ();
+
+    random_r (R, &n);
+    return n;
+}
+
+static void prepare_data (thing A[], unsigned size, int ini,
+                          struct random_data * R)
+{
+    unsigned u, n;
+    thing tmp;
+
+    for (u=0; u<size; u++)
+        A[u] = ini==1 ? size-u-1 : u;
+
+    if (ini!=2)
+        return;
+
+    if (!R)
+        srand (0);
+
+    for (u=0; u<5; u++)
+        next_random (R);
+
+    for (u=0; u<size-1; u++)
+    {
+        n = 1 + u + (unsigned)(next_random(R) * (size-u-1.0) /
+                               RAND_MAX);
+
+        if (n>size-1)
+            n = size-1;
+
+        if (n!=u)
+        {
+            tmp = A[n];
+            A[n] = A[u];
+            A[u] = tmp;
+        }
+    }
+}
+
+// Sorts the data of a cell in A, counting the operations. Returns
+// -1 if the array doesn't end up sorted
 
-int main ()
+static int count_cell (scell * c, thing A[])
 {
-    // Initial states of the array: ASCending order,
-    // DEScending order and RANdom order (or rather disorder)
-    const char * initial[NUM_INI] = { "ASC", "DES", "RAN" };
+    scontrol C;
+    struct random_data R;
+    char state[128];        // As large as that of rand()
+    unsigned u;
+
+    memset (&C, 0, sizeof(C));
+    C.pdata = A;
+
+    if (sorts[c->a]==quick_sort_pa)
+    {
+        // The pivots follow the numbers of the shuffle, or the
+        // first numbers of rand() if there is none, as in gen_trace
+        pthread_mutex_lock (&rand_lock);
+        srand (1);
+        prepare_data (A, c->size, c->i, NULL);
+        sorts[c->a] (&C, c->size, count_lesser_than,
+                     count_read, count_write);
+        pthread_mutex_unlock (&rand_lock);
+    }
+    else
+    {
+        // Seed 0 is taken as 1, as in srand()
+        memset (&R, 0, sizeof(R));
+        initstate_r (0, state, sizeof(state), &R);
+        prepare_data (A, c->size, c->i, &R);
+        sorts[c->a] (&C, c->size, count_lesser_than,
+                     count_read, count_write);
+    }
 
-    // Array sizes with wich to experiment
-    unsigned sizes[NUM_SZS] = { 10, 100, 1000 };
+    for (u=0; u+1<c->size && A[u]<=A[u+1]; u++)
+        ;
 
-    // Sorting algorithms: bubble, insertion, selection,
-    // heapsort, combsort, mergesort, quicksort, and
-    // quicksort with random pivot
-    const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
-                                         "HEA", "COM", "MER",
-                                         "QUI", "QRP" };
+    c->total = u+1==c->size ? C.nreads + C.nwrites + C.ncomparisons : 0;
 
-    char command[100]; // Command for executing gen_trace
-    FILE * pipe;       // Channel for communicating with gen_trace
-    int a, i, t, ok;   // Array indexes and flag
-    char op;           // Elementary operation ('R'ead, 'W'rite...)
-    unsigned u;        // Number of read/written element
-    unsigned sz;       // Size of the array to sort
+    return c->total ? 0 : -1;
+}
 
-    unsigned reads, writes, comparisons;            // Counters
-    unsigned results[NUM_ALG][NUM_INI][NUM_SZS];    // Tables
+static int compare_sizes (const void * a, const void * b)
+{
+    unsigned x = (*(scell * const *) a)->size,
+             y = (*(scell * const *) b)->size;
+
+    return x>y ? -1 : x<y;
+}
 
-    // Carry out experiments and fill results tables
+// Main function
 
-    for (t=0; t<NUM_SZS; t++)
-        for (a=0; a<NUM_ALG; a++)
-            for (i=0; i<NUM_INI; i++)
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    spool pool;
+    scell * cells;
+    pthread_t * tid;
+    int numcells, numdb, a, i, s, n;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    numcells = P.numalg*P.numini*P.numsizes;
+    cells = (scell*) calloc (numcells, sizeof(scell));
+    pool.pending = (scell**) malloc (numcells*sizeof(scell*));
+    tid = (pthread_t*) malloc (P.threads*sizeof(pthread_t));
+
+    if (!cells || !pool.pending || !tid)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (s=n=0; s<P.numsizes; s++)
+        for (a=0; a<P.numalg; a++)
+            for (i=0; i<P.numini; i++, n++)
             {
-                sz = sizes[t];
-                reads = writes = comparisons = 0;
-
-                // Make command to invoke gen_trace
-                // (sprintf "prints" in a string)
-                sprintf (command, "./gen_trace %s %s %u",
-                                  algorithms[a], initial[i], sz);
-
-                printf ("Executing command: %s\n", command);
-
-                // Invoke gen_trace and open pipe for reading
-                // its standard output ("r" stands for read)
-                pipe = popen (command, "r");
-
-                if (!pipe)
-                {
-                    perror ("ERROR starting gen_trace");
-                    return -1;
-                }
-
-                // Read (and ignore) size
-                ok = fscanf (pipe," T %u", &u) == 1;
-
-                while (ok)
-                {
-                    // Ignore spaces and read one character
-                    if (fscanf(pipe," %c",&op)!=1)
-                    {
-                        ok = 0;
-                        break;
-                    }
-
-                    if (op=='R' || op=='W')  // If it's a read
-                    {                        // or a write,
-                        if (op=='R')         // count it and read
-                            reads ++;        // the number of the
-                        else                 // referenced
-                            writes ++;       // element (u)
-
-                        if (fscanf(pipe,"%u",&u)!=1)
-                            ok = 0;
-                    }
-                    else if (op=='C')        // 'C'omparison
-                        comparisons ++;
-                    else if (op=='S')        // 'S'orted (end)
-                        break;
-                    else                     // 'O'ut of order (or
-                        ok = 0;              // sth. else) -> error
-                }
-
-                // Wait until gen_trace ends and close
-                if (pclose(pipe)==-1)
-                    ok = 0;
-
-                // Store number of operations in the table
-                // (0 if an error occurred)
-                results[a][i][t] = ok ? reads +
-                                        writes +
-                                        comparisons : 0;
+                cells[n].a = P.alg[a];
+                cells[n].i = P.ini[i];
+                cells[n].size = P.sizes[s];
             }
 
-    // Print tables
+    // Cells counted in previous runs
+    numdb = read_db (P.dbfile, cells, numcells);
+
+    pool.db = fopen (P.dbfile, "a");
+
+    if (!pool.db)
+    {
+        perror ("ERROR opening the results file");
+        return -1;
+    }
+
+    if (ftell(pool.db)==0)
+        fprintf (pool.db, "algorithm,initial,size,operations\n");
+
+    for (n=pool.numpending=0; n<numcells; n++)
+        if (!cells[n].done)
+            pool.pending[pool.numpending++] = &cells[n];
 
-    for (i=0; i<NUM_INI; i++)
+    qsort (pool.pending, pool.numpending, sizeof(scell*), compare_sizes);
+
+    pool.next = pool.errors = 0;
+    pthread_mutex_init (&pool.lock, NULL);
+
+    if (P.threads>pool.numpending)
+        P.threads = pool.numpending;
+
+    fprintf (stderr, "# %d cells: %d in %s, %d to count with "
+             "%d threads\n", numcells, numdb, P.dbfile,
+             pool.numpending, P.threads);
+
+    for (n=0; n<P.threads; n++)
+        if (pthread_create(&tid[n],NULL,worker_thread,&pool))
+        {
+            fprintf (stderr, "ERROR: can't create a thread\n");
+            return -1;
+        }
+
+    for (n=0; n<P.threads; n++)
+        pthread_join (tid[n], NULL);
+
+    fclose (pool.db);
+    print_tables (&P, cells);
+
+    if (P.fit)
+        print_fit (&P, cells);
+
+    free (cells);
+    free (pool.pending);
+    free (tid);
+
+    return pool.errors ? -1 : 0;
+}
+
+// Takes the cells found in the results file (if it exists) and
+// returns how many there were
+
+int read_db (const char * file, scell cells[], int numcells)
+{
+    FILE * f = fopen (file, "r");
+    char line[256], alg[8], ini[8];
+    unsigned size;
+    unsigned long long total;
+    int n, found = 0;
+
+    if (!f)
+        return 0;
+
+    while (fgets(line,sizeof(line),f))
     {
-        printf ("\n\nInitial state: %s\n", initial[i]);
+        if (sscanf(line,"%7[^,],%7[^,],%u,%llu",
+                   alg,ini,&size,&total)!=4)
+            continue;   // The header
+
+        for (n=0; n<numcells; n++)
+            if (!cells[n].done && cells[n].size==size &&
+                !strcmp(algorithms[cells[n].a],alg) &&
+                !strcmp(initial[cells[n].i],ini))
+            {
+                cells[n].done = 1;
+                cells[n].total = total;
+                found ++;
+            }
+    }
+
+    fclose (f);
+    return found;
+}
+
+// Function of the threads: counts the pending cells until there
+// are no more, adding the results to the file
+
+void * worker_thread (void * arg)
+{
+    spool * pool = (spool*) arg;
+    thing * A = NULL, * B;
+    unsigned maxsize = 0, size;
+    scell * c;
+
+    for (;;)
+    {
+        pthread_mutex_lock (&pool->lock);
+        c = pool->next < pool->numpending ?
+            pool->pending[pool->next++] : NULL;
+        pthread_mutex_unlock (&pool->lock);
+
+        if (!c)
+            break;
+
+        // Twice the size for the temporary array of mergesort
+        size = sorts[c->a]==merge_sort ? 2*c->size : c->size;
+
+        if (size>maxsize)
+        {
+            B = (thing*) realloc (A, size*sizeof(thing));
+
+            if (!B)
+            {
+                pthread_mutex_lock (&pool->lock);
+                fprintf (stderr, "ERROR: not enough dynamic memory "
+                         "for %s %s %u\n", algorithms[c->a],
+                         initial[c->i], c->size);
+                pool->errors ++;
+                pthread_mutex_unlock (&pool->lock);
+                continue;
+            }
+
+            A = B;
+            maxsize = size;
+        }
+
+        count_cell (c, A);
+
+        pthread_mutex_lock (&pool->lock);
+        c->done = 1;
+
+        if (c->total)
+        {
+            fprintf (pool->db, "%s,%s,%u,%llu\n", algorithms[c->a],
+                     initial[c->i], c->size, c->total);
+            fflush (pool->db);
+        }
+        else
+        {
+            fprintf (stderr, "ERROR: %s didn't sort %s %u\n",
+                     algorithms[c->a], initial[c->i], c->size);
+            pool->errors ++;
+        }
+
+        pthread_mutex_unlock (&pool->lock);
+    }
+
+    free (A);
+    return NULL;
+}
+
+// Prints one table per initial state, with one row per size and
+// one column per algorithm (0 if an error occurred)
+
+void print_tables (const sparameters * P, const scell cells[])
+{
+    int a, i, s;
+    const scell * c;
+
+    for (i=0; i<P->numini; i++)
+    {
+        printf ("\n\nInitial state: %s\n", initial[P->ini[i]]);
         printf ("===================\nSize");
 
-        for (a=0; a<NUM_ALG; a++)
-            printf ("%8s", algorithms[a]);
+        for (a=0; a<P->numalg; a++)
+            printf ("%8s", algorithms[P->alg[a]]);
 
         printf ("\n\n");
 
-        for (t=0; t<NUM_SZS; t++)
+        for (s=0; s<P->numsizes; s++)
         {
-            printf ("%6u", sizes[t]);
+            printf ("%6u", P->sizes[s]);
+
+            for (a=0; a<P->numalg; a++)
+            {
+                c = &cells[(s*P->numalg + a)*P->numini + i];
 
-            for (a=0; a<NUM_ALG; a++)
-                if (results[a][i][t]<1000000)
-                    printf (" %7u", results[a][i][t]);
+                if (c->total<1000000)
+                    printf (" %7llu", c->total);
                 else
-                    printf (" %7.1e", (float)results[a][i][t]);
+                    printf (" %7.1e", (double) c->total);
+            }
 
             printf ("\n");
         }
     }
 
     printf ("\n");
+}
+
+// Fits operations = C * size^k to the sizes of each algorithm and
+// initial state, by least squares on log(size) and log(operations),
+// and predicts the length of the trace for another size. Over a
+// geometric range of sizes k is the order of growth: close to 2
+// for the O(N*N) cases and a bit over 1 for O(N log N)
+
+void print_fit (const sparameters * P, const scell cells[])
+{
+    int a, i, s, n;
+    double x, y, sx, sy, sxx, sxy, syy, k, c, vx, vy, r2;
+    const scell * p;
+    char name[32];
+
+    sprintf (name, "Ops(%u)", P->predict);
+
+    printf ("\n\nScaling: operations = C * size^k\n"
+            "===================\n%-6s %-6s %8s %12s %8s",
+            "Alg", "Init", "k", "C", "R^2");
+
+    if (P->predict)
+        printf (" %14s", name);
+
+    printf ("\n\n");
+
+    for (i=0; i<P->numini; i++)
+        for (a=0; a<P->numalg; a++)
+        {
+            sx = sy = sxx = sxy = syy = 0;
+
+            for (s=n=0; s<P->numsizes; s++)
+            {
+                p = &cells[(s*P->numalg + a)*P->numini + i];
 
-    return 0;
+                if (!p->total)      // Error
+                    continue;
+
+                x = log (p->size);
+                y = log (p->total);
+                sx += x;
+                sy += y;
+                sxx += x*x;
+                sxy += x*y;
+                syy += y*y;
+                n ++;
+            }
+
+            vx = n*sxx - sx*sx;
+            vy = n*syy - sy*sy;
+
+            printf ("%-6s %-6s", algorithms[P->alg[a]],
+                    initial[P->ini[i]]);
+
+            // Two different sizes at least
+            if (n<2 || vx<=1e-9*n*sxx)
+            {
+                printf (" %8s\n", "-");
+                continue;
+            }
+
+            k = (n*sxy - sx*sy) / vx;
+            c = exp ((sy - k*sx) / n);
+            r2 = vy>1e-9*n*syy ? (n*sxy - sx*sy)*(n*sxy - sx*sy) /
+                                 (vx*vy) : 1;
+
+            printf (" %8.3f %12.4g %8.4f", k, c, r2);
+
+            if (P->predict)
+                printf (" %14.3e", c*pow(P->predict,k));
+
+            printf ("\n");
+        }
+
+    printf ("\n");
 }
 
+// Function that parses a list of numbers: "A,B,C" or "A-B*M"
+// (from A to B multiplying by M). Returns how many or -1
+
+static int parse_numbers (const char * s, unsigned v[], unsigned min)
+{
+    unsigned a, b, m;
+    int n = 0, len;
+
+    for (;;)
+    {
+        m = 0;
+
+        if (sscanf(s,"%u-%u*%u%n",&a,&b,&m,&len)==3)
+        {
+            if (m<2)
+                return -1;
+        }
+        else if (sscanf(s,"%u%n",&a,&len)==1)
+            b = a;
+        else
+            return -1;
+
+        s += len;
+
+        if (a<min || b<a)
+            return -1;
+
+        for (; a<=b; a = m ? a*m : b+1)
+        {
+            if (n==MAX_SZS)
+                return -1;
+
+            v[n++] = a;
+        }
+
+        if (*s=='\0')
+            return n;
+
+        if (*s++!=',')
+            return -1;
+    }
+}
+
+// Function that looks up a list of names separated by commas
+// (or "all") in a table. Returns how many there are or -1
+
+static int parse_names (const char * s, const char ** table,
+                        int size, int v[])
+{
+    int n = 0, i, len;
+
+    if (!strcmp(s,"all"))
+    {
+        for (i=0; i<size; i++)
+            v[i] = i;
+
+        return size;
+    }
+
+    for (; *s; s += len + (s[len]==','))
+    {
+        len = strcspn (s, ",");
+
+        for (i=0; i<size; i++)
+            if (strlen(table[i])==len && !strncmp(table[i],s,len))
+                break;
+
+        if (i==size || n==size)
+            return -1;
+
+        v[n++] = i;
+    }
+
+    return n ? n : -1;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i;
+
+    // Default parameters
+    p->numalg = parse_names ("all", algorithms, NUM_ALG, p->alg);
+    p->numini = parse_names ("all", initial, NUM_INI, p->ini);
+    p->numsizes = parse_numbers ("10-1000*10", p->sizes, 2);
+    p->dbfile = "count_ops.csv";
+    p->threads = 4;
+    p->fit = 0;
+    p->predict = 0;
+
+    for (i=1, ok=1; i<argc; i++)
+        if (parse_option(argv[i],p)<0)
+            ok = 0;
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s [options]\n\n", argv[0]);
+
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--alg=LIST: BUB, INS, SEL, HEA, COM, MER, QUI,\n"
+             "\t        QRP or all (all)\n"
+             "\t--init=LIST: ASC, DES, RAN or all (all)\n"
+             "\t--size=LIST: sizes, as A,B,C or A-B*FACTOR\n"
+             "\t        (10-1000*10)\n"
+             "\t--db=FILE: CSV file with the results; the cells\n"
+             "\t        in it are not counted again (count_ops.csv)\n"
+             "\t--threads=N: threads that count (4)\n"
+             "\t--fit: fit operations = C * size^k to the sizes\n"
+             "\t        of each algorithm and initial state\n"
+             "\t--predict=N: with --fit, operations (length of\n"
+             "\t        the trace) for N elements\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s --alg=HEA,MER,QRP --size=1000-1000000*10\n"
+             "\t%s --size=100-10000*10 --fit --predict=1000000\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok;
+
+    if (!strncmp(arg,"--alg=",6))
+        ok = (p->numalg = parse_names(arg+6,algorithms,NUM_ALG,
+                                      p->alg)) > 0;
+    else if (!strncmp(arg,"--init=",7))
+        ok = (p->numini = parse_names(arg+7,initial,NUM_INI,
+                                      p->ini)) > 0;
+    else if (!strncmp(arg,"--size=",7))
+        ok = (p->numsizes = parse_numbers(arg+7,p->sizes,2)) > 0;
+    else if (!strncmp(arg,"--db=",5))
+        ok = *(p->dbfile = arg+5) != 0;
+    else if (!strncmp(arg,"--threads=",10))
+        ok = sscanf(arg+10,"%d",&p->threads)==1 &&
+             p->threads>0 && p->threads<=256;
+    else if (!strcmp(arg,"--fit"))
+        ok = p->fit = 1;
+    else if (!strncmp(arg,"--predict=",10))
+        ok = sscanf(arg+10,"%u",&p->predict)==1 && p->predict>1 &&
+             (p->fit = 1);
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
@@ -0,0 +1,177 @@
+/*
+    perf_counters.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char * names[PERF_NUMCOUNTERS] =
+{
+    "Cycles", "Instructions", "LLC misses", "Branch misses"
+};
+
+#ifdef __linux__
+
+static const unsigned long long configs[PERF_NUMCOUNTERS] =
+{
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+int perf_open (sperfcounters * C)
+{
+    struct perf_event_attr attr;
+    int i, n;
+
+    C->error = 0;
+    C->valid = 0;
+
+    for (i=n=0; i<PERF_NUMCOUNTERS; i++)
+    {
+        memset (&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // This process only (not gen_trace), on any CPU
+        C->fd[i] = syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        C->value[i] = 0;
+
+        if (C->fd[i]>=0)
+            n ++;
+        else if (!C->error)
+            C->error = errno;
+    }
+
+    return n;
+}
+
+void perf_start (sperfcounters * C)
+{
+    int i;
+
+    for (i=0; i<PERF_NUMCOUNTERS; i++)
+        if (C->fd[i]>=0)
+        {
+            ioctl (C->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl (C->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+void perf_stop (sperfcounters * C)
+{
+    unsigned long long data[3];     // Value, enabled, running
+    int i;
+
+    for (i=0; i<PERF_NUMCOUNTERS; i++)
+    {
+        if (C->fd[i]<0)
+            continue;
+
+        ioctl (C->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(C->fd[i],data,sizeof(data))==sizeof(data) && data[2])
+        {
+            C->value[i] = data[2]<data[1] ?
+                          (double) data[0] * data[1] / data[2] :
+                          data[0];
+            C->valid |= 1u<<i;
+        }
+        else
+            C->error = EIO;
+
+        close (C->fd[i]);
+        C->fd[i] = -1;
+    }
+}
+
+#else
+
+int perf_open (sperfcounters * C)
+{
+    int i;
+
+    for (i=0; i<PERF_NUMCOUNTERS; i++)
+    {
+        C->fd[i] = -1;
+        C->value[i] = 0;
+    }
+
+    C->error = ENOSYS;
+    C->valid = 0;
+    return 0;
+}
+
+void perf_start (sperfcounters * C)
+{
+}
+
+void perf_stop (sperfcounters * C)
+{
+}
+
+#endif // __linux__
+
+void perf_print (const sperfcounters * C, unsigned long long numrefs)
+{
+    const unsigned long long * v = C->value;
+    int i, have[PERF_NUMCOUNTERS];
+    double refs = numrefs ? numrefs : 1;
+
+    for (i=0; i<PERF_NUMCOUNTERS; i++)
+        have[i] = (C->valid>>i) & 1;
+
+    if (!C->valid)
+    {
+        printf ("Hardware counters not available (%s)\n",
+                strerror(C->error));
+
+        if (C->error==EACCES || C->error==EPERM)
+            printf ("See /proc/sys/kernel/perf_event_paranoid\n");
+
+        return;
+    }
+
+    for (i=0; i<PERF_NUMCOUNTERS; i++)
+        if (have[i])
+            printf ("%-15s %15llu  %10.3f per reference\n",
+                    names[i], v[i], v[i]/refs);
+        else
+            printf ("%-15s %15s\n", names[i], "not available");
+
+    printf ("\n");
+
+    // Ratios only with instructions (and cycles) counted
+    if (!v[PERF_INSTRUCTIONS])
+        return;
+
+    if (have[PERF_CYCLES] && v[PERF_CYCLES])
+        printf ("Instructions per cycle:              %.2f\n",
+                (double) v[PERF_INSTRUCTIONS]/v[PERF_CYCLES]);
+
+    if (have[PERF_LLC_MISSES])
+        printf ("LLC misses per 1000 instructions:    %.3f\n",
+                1000.0*v[PERF_LLC_MISSES]/v[PERF_INSTRUCTIONS]);
+
+    if (have[PERF_BRANCH_MISSES])
+        printf ("Branch misses per 1000 instructions: %.3f\n",
+                1000.0*v[PERF_BRANCH_MISSES]/v[PERF_INSTRUCTIONS]);
+}
@@ -0,0 +1,44 @@
+/*
+    perf_counters.h
+*/
+
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+// Hardware performance counters of the process itself (Linux
+// perf_event_open), to be read around a loop: cycles,
+// instructions, misses of the last level cache and mispredicted
+// branches. Counters the kernel doesn't allow (or the processor
+// doesn't have) are left out and shown as not available
+
+enum
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NUMCOUNTERS
+};
+
+typedef struct
+{
+    int fd[PERF_NUMCOUNTERS];     // -1 = not available
+    unsigned long long value[PERF_NUMCOUNTERS];
+    unsigned valid;               // Bit 1<<i = value[i] was read
+    int error;                    // errno of the first failure
+}
+sperfcounters;
+
+// perf_open returns the number of counters that could be
+// opened; perf_stop reads them (scaled if the kernel had to
+// multiplex them) and closes them
+
+int perf_open (sperfcounters *);
+void perf_start (sperfcounters *);
+void perf_stop (sperfcounters *);
+
+// Shows the counters and their ratios per reference
+
+void perf_print (const sperfcounters *, unsigned long long numrefs);
+
+#endif // _PERF_COUNTERS_H_
@@ -0,0 +1,404 @@
+/*
+    reuse_dist.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "stack_dist.h"
+
+// Shows the distribution of the reuse distances (different pages
+// referenced between two references to the same page) and of the
+// reuse times (references between them) of a trace. The distances
+// come from the LRU stack of stack_dist.c (a Fenwick tree, O(log n)
+// per reference). A reference with distance d hits in LRU with
+// more than d frames, so the cumulative column of the distances
+// is the hit ratio of LRU for every number of frames.
+//
+// The histograms have buckets of growing size: each power of two
+// is split in --sub buckets, so that they take little memory
+// whatever the length of the trace, with a bounded relative error
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagsz;
+    const char * algorithm, * initialorder;
+    int numelem;
+
+    // Options (--name=value) that may follow the parameters
+    const char * tracefile;     // Trace saved by gen_trace
+    int sub;                    // Buckets per power of two
+}
+sparameters;
+
+// Histogram with log buckets: values 0..sub-1 have their own
+// bucket, and then each [2^e, 2^(e+1)) is split in sub buckets
+
+#define MAX_EXP 64
+
+typedef struct
+{
+    int sub, logsub;
+    int numbuckets;
+    unsigned long long * count;
+    unsigned long long total;   // Values counted
+    double sum;                 // ...and their sum
+}
+sloghist;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+int reserve_loghist (sloghist *, int sub);
+void free_loghist (sloghist *);
+void count_value (sloghist *, unsigned long long v);
+void print_loghist (const sloghist *, const char * title,
+                    unsigned long long numrefs);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    strace T;           // Trace (from gen_trace or from a file)
+    int ok, r;          // Flags
+    char op;            // Elementary operation ('R'ead, 'W'ri..)
+    unsigned u, d;      // Element, stack distance
+    int page, numpags;  // Page referenced, total number of pages
+    unsigned long long t, * last, cold, illegal;
+    sstackdist D;       // LRU stack
+    sloghist H, R;      // Distances and times
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %i %s %s %i\n",
+            argv[0], P.pagsz,
+            P.algorithm, P.initialorder, P.numelem);
+
+    if (trace_open(&T,P.tracefile,P.algorithm,
+                   P.initialorder,P.numelem)<0)
+        return -1;
+
+    printf ("# Executing command:  %s\n", T.command);
+
+    // Calculate total number of pages
+    numpags = (T.totelem+P.pagsz-1) / P.pagsz;
+
+    last = (unsigned long long*) calloc (numpags, sizeof(*last));
+    ok = last && stack_dist_init (&D, numpags, numpags) == 0 &&
+         reserve_loghist (&H, P.sub) == 0 &&
+         reserve_loghist (&R, P.sub) == 0;
+
+    if (!ok)
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+
+    for (t=cold=illegal=0; ok; )
+    {
+        r = trace_next (&T, &op, &u);
+
+        if (r<=0)        // 'S'orted -> end
+        {                // (or something else -> error)
+            ok = r==0;
+            break;
+        }
+
+        page = u / P.pagsz;
+
+        if (page>=numpags)
+        {
+            illegal ++;
+            continue;
+        }
+
+        t ++;
+        d = stack_dist_ref (&D, page);
+
+        if (d)
+        {
+            count_value (&H, d-1);
+            count_value (&R, t-last[page]-1);
+        }
+        else
+            cold ++;
+
+        last[page] = t;
+    }
+
+    if (ok)
+    {
+        printf ("# %llu references to %llu pages of %d elements\n",
+                t, cold, P.pagsz);
+
+        if (illegal)
+            printf ("# %llu references out of the address space "
+                    "(not counted)\n", illegal);
+
+        print_loghist (&H, "REUSE DISTANCE (pages in between)", t);
+        print_loghist (&R, "REUSE TIME (references in between)", t);
+
+        printf ("\n# First references (cold):  %llu (%.4f)\n",
+                cold, t ? (double) cold/t : 0);
+        printf ("# With c frames, LRU faults on the first "
+                "references and on those at a distance >= c\n");
+    }
+
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    free (last);
+    stack_dist_free (&D);
+    free_loghist (&H);
+    free_loghist (&R);
+
+    return ok ? 0 : -1;
+}
+
+// Functions that manipulate the histograms
+
+int reserve_loghist (sloghist * L, int sub)
+{
+    L->sub = sub;
+
+    for (L->logsub=0; (1<<L->logsub) < sub; L->logsub++)
+        ;
+
+    L->numbuckets = sub + (MAX_EXP-L->logsub)*sub;
+    L->count = (unsigned long long*) calloc (L->numbuckets,
+                                             sizeof(*L->count));
+    L->total = 0;
+    L->sum = 0;
+
+    return L->count ? 0 : -1;
+}
+
+void free_loghist (sloghist * L)
+{
+    free (L->count);
+    L->count = NULL;
+}
+
+// Bucket of a value and range of values of a bucket
+
+static int bucket_of (const sloghist * L, unsigned long long v)
+{
+    int e;
+
+    if (v < (unsigned long long) L->sub)
+        return v;
+
+    for (e=L->logsub; e+1<MAX_EXP && v >> (e+1); e++)
+        ;
+
+    return L->sub + (e-L->logsub)*L->sub +
+           (int) ((v - (1ULL<<e)) >> (e-L->logsub));
+}
+
+static void bucket_range (const sloghist * L, int b,
+                          unsigned long long * lo,
+                          unsigned long long * hi)
+{
+    int e;
+
+    if (b < L->sub)
+    {
+        *lo = *hi = b;
+        return;
+    }
+
+    b -= L->sub;
+    e = L->logsub + b/L->sub;
+    *lo = (1ULL<<e) + ((unsigned long long) (b%L->sub) << (e-L->logsub));
+    *hi = *lo + (1ULL<<(e-L->logsub)) - 1;
+}
+
+void count_value (sloghist * L, unsigned long long v)
+{
+    L->count[bucket_of(L,v)] ++;
+    L->total ++;
+    L->sum += v;
+}
+
+// Shows the non-empty buckets, with the fraction of all the
+// references (numrefs, first ones included) and the cumulative
+// fraction up to the end of each bucket
+
+void print_loghist (const sloghist * L, const char * title,
+                    unsigned long long numrefs)
+{
+    unsigned long long lo, hi, cumul = 0, median = 0;
+    double refs = numrefs ? numrefs : 1;
+    int b, last, found = 0;
+
+    for (last=L->numbuckets-1; last>0 && !L->count[last]; last--)
+        ;
+
+    printf ("\n%s\n\n%12s %12s %14s %10s %10s\n", title, "FROM", "TO",
+            "REFERENCES", "FRACTION", "CUMULATIVE");
+
+    for (b=0; b<=last; b++)
+    {
+        if (!L->count[b])
+            continue;
+
+        bucket_range (L, b, &lo, &hi);
+        cumul += L->count[b];
+
+        if (!found && 2*cumul >= L->total)
+        {
+            median = hi;
+            found = 1;
+        }
+
+        printf ("%12llu %12llu %14llu %10.6f %10.6f\n", lo, hi,
+                L->count[b], L->count[b]/refs, cumul/refs);
+    }
+
+    printf ("\nMean: %.2f   Median: <= %llu\n",
+            L->total ? L->sum/L->total : 0, median);
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
+#define VALID_INIT_ORD "ASC/DES/RAN"
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i, n;
+
+    // Default parameters
+    p->pagsz = 16;
+    p->algorithm = "MER";
+    p->initialorder = "RAN";
+    p->numelem = 1000;
+    p->tracefile = NULL;
+    p->sub = 1;
+
+    // Take the options out of argv, so that the remaining
+    // parameters keep their positions
+    for (i=n=1, ok=1; i<argc; i++)
+        if (!strncmp(argv[i],"--",2))
+        {
+            if (parse_option(argv[i],p)<0)
+                ok = 0;
+        }
+        else
+            argv[n++] = argv[i];
+
+    argc = n;
+
+    if (argc>5)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
+                       p->pagsz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->algorithm = argv[2];
+
+        if (strlen(p->algorithm)!=3 ||
+            strchr(p->algorithm,'/') ||
+            !strstr(VALID_ALGORITHMS,p->algorithm))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->initialorder = argv[3];
+
+        if (strlen(p->initialorder)!=3 ||
+            strchr(p->initialorder,'/') ||
+            !strstr(VALID_INIT_ORD,p->initialorder))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial order");
+            ok = 0;
+        }
+
+        if (argc>4 && (sscanf(argv[4],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s pagesz algorithm "
+             "initialorder numelem\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tpagesz: # of elements that fit in a page\n"
+             "\talgorithm: sorting algorithm (%s)\n"
+             "\tinitialorder: initial order of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--trace=FILE: read the trace from a file saved\n"
+             "\t        with gen_trace instead of running it\n"
+             "\t--sub=N: buckets per power of two (1, 2, 4...\n"
+             "\t        up to 1024) (1)\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 16 MER RAN 1000\n"
+             "\t%s 1 QUI RAN 10000 --sub=8\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok;
+
+    if (!strncmp(arg,"--trace=",8))
+        ok = *(p->tracefile = arg+8) != 0;
+    else if (!strncmp(arg,"--sub=",6))
+        ok = sscanf(arg+6,"%d",&p->sub)==1 && p->sub>0 &&
+             p->sub<=1024 && !(p->sub & (p->sub-1));
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
@@ -0,0 +1,126 @@
+/*
+    sample.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sample.h"
+
+// Function that sets up sampling with a fixed rate (0 < rate <= 1).
+// Returns 0 if OK
+
+int sample_init_rate (ssample * A, double rate)
+{
+    if (rate<=0 || rate>1)
+        return -1;
+
+    A->threshold = (unsigned) (rate*SAMPLE_MODULUS + 0.5);
+
+    if (A->threshold==0)
+        A->threshold = 1;
+
+    A->maxpages = A->numpages = 0;
+    A->heap = NULL;
+    A->heappage = NULL;
+
+    return 0;
+}
+
+// Function that sets up sampling with a fixed size: the rate
+// starts at 1 and goes down as the sample grows. Returns 0 if OK
+
+int sample_init_size (ssample * A, int maxpages)
+{
+    if (maxpages<1)
+        return -1;
+
+    A->threshold = SAMPLE_MODULUS;
+    A->maxpages = maxpages;
+    A->numpages = 0;
+    A->heap = (unsigned*) malloc ((maxpages+1)*sizeof(unsigned));
+    A->heappage = (int*) malloc ((maxpages+1)*sizeof(int));
+
+    if (!A->heap || !A->heappage)
+    {
+        sample_free (A);
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Swaps two elements of the heap
+
+static void heap_swap (ssample * A, int i, int j)
+{
+    unsigned h = A->heap[i];
+    int p = A->heappage[i];
+
+    A->heap[i] = A->heap[j];
+    A->heappage[i] = A->heappage[j];
+    A->heap[j] = h;
+    A->heappage[j] = p;
+}
+
+// Takes the largest hash out of the heap
+
+static void heap_pop (ssample * A)
+{
+    int i, c;
+
+    A->numpages --;
+    heap_swap (A, 0, A->numpages);
+
+    for (i=0; (c=2*i+1)<A->numpages; i=c)
+    {
+        if (c+1<A->numpages && A->heap[c+1]>A->heap[c])
+            c ++;
+
+        if (A->heap[c]<=A->heap[i])
+            break;
+
+        heap_swap (A, i, c);
+    }
+}
+
+int sample_add (ssample * A, int page, int dropped[])
+{
+    int i, n;
+    unsigned h;
+
+    if (!A->maxpages)
+        return 0;
+
+    // Push the new page
+    i = A->numpages++;
+    A->heap[i] = sample_hash(page);
+    A->heappage[i] = page;
+
+    for (; i>0 && A->heap[(i-1)/2]<A->heap[i]; i=(i-1)/2)
+        heap_swap (A, i, (i-1)/2);
+
+    if (A->numpages<=A->maxpages)
+        return 0;
+
+    // Too many pages: drop every page with the largest hash
+    h = A->heap[0];
+
+    for (n=0; A->numpages && A->heap[0]==h; n++)
+    {
+        dropped[n] = A->heappage[0];
+        heap_pop (A);
+    }
+
+    A->threshold = h;
+    return n;
+}
+
+void sample_free (ssample * A)
+{
+    free (A->heap);
+    free (A->heappage);
+    A->heap = NULL;
+    A->heappage = NULL;
+}
@@ -0,0 +1,61 @@
+/*
+    sample.h
+*/
+
+#ifndef _SAMPLE_H_
+#define _SAMPLE_H_
+
+// Spatially hashed sampling of pages (SHARDS): a page is in the
+// sample if the hash of its number is below a threshold, so all
+// the references to a sampled page are simulated and the others
+// are skipped. With a fixed rate R the threshold never changes;
+// with a fixed size, when the sample gets more than maxpages
+// pages the one with the largest hash is dropped and the
+// threshold goes down to its hash.
+
+#define SAMPLE_MODULUS (1u<<24)     // Hashes are 0..MODULUS-1
+
+typedef struct
+{
+    unsigned threshold;   // Pages with hash below it are sampled
+    int maxpages;         // Max. pages in the sample (0 = fixed rate)
+    int numpages;         // Pages in the sample (fixed size only)
+    unsigned * heap;      // Max-heap of the hashes of the sample
+    int * heappage;       // ... and their pages
+}
+ssample;
+
+// Hash of a page number (0..SAMPLE_MODULUS-1)
+
+static inline unsigned sample_hash (unsigned page)
+{
+    page ^= page >> 16;
+    page *= 0x85ebca6bu;
+    page ^= page >> 13;
+    page *= 0xc2b2ae35u;
+    page ^= page >> 16;
+
+    return page & (SAMPLE_MODULUS-1);
+}
+
+static inline int sample_wanted (const ssample * A, unsigned page)
+{
+    return sample_hash(page) < A->threshold;
+}
+
+static inline double sample_rate (const ssample * A)
+{
+    return (double) A->threshold / SAMPLE_MODULUS;
+}
+
+// Functions that set up the sample and, with a fixed size, add
+// a page that is referenced for the first time. sample_add
+// stores in dropped[] the pages that leave the sample (if any,
+// the new page may be one of them) and returns how many
+
+int sample_init_rate (ssample *, double rate);
+int sample_init_size (ssample *, int maxpages);
+int sample_add (ssample *, int page, int dropped[]);
+void sample_free (ssample *);
+
+#endif // _SAMPLE_H_
@@ -0,0 +1,750 @@
+/*
+    sim_pag_bench.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "sim_paging.h"
+#include "trace.h"
+
+// Measures the CPU cost of the replacement policies as the
+// physical memory grows: each policy runs the same traces with
+// numbers of frames from 16 to about 10^6, a few times after a
+// warm-up run, and the program shows the time per reference and
+// per page fault (mean and 95% confidence interval) and the peak
+// resident memory of the run. Reading the clock at every
+// reference would slow the references down, so each measured run
+// is done twice: once timed as a whole (per reference), and once
+// adding up only the time of the references that fault.
+//
+// Every configuration runs in a child process, so that its
+// peak RSS is its own and a policy that blows up doesn't take
+// the others with it. The child starts with the pages of its
+// parent (the traces), so its RSS at the fork is taken out. A
+// run that goes beyond --max-seconds stops there and is measured
+// on the references it got through
+
+// The policies, built with -DPOLICY=name (see sim_pag_sweep.c)
+
+#define DECLARE_POLICY(p) \
+    void p##_init_tables (ssystem *); \
+    unsigned p##_sim_mmu (ssystem *, unsigned, char);
+
+DECLARE_POLICY(random)
+DECLARE_POLICY(lru)
+DECLARE_POLICY(fifo)
+DECLARE_POLICY(fifo2ch)
+DECLARE_POLICY(ws)
+DECLARE_POLICY(pff)
+
+static const spolicy policies[] =
+{
+    { "random",  random_init_tables,  random_sim_mmu },
+    { "lru",     lru_init_tables,     lru_sim_mmu },
+    { "fifo",    fifo_init_tables,    fifo_sim_mmu },
+    { "fifo2ch", fifo2ch_init_tables, fifo2ch_sim_mmu },
+    { "ws",      ws_init_tables,      ws_sim_mmu },
+    { "pff",     pff_init_tables,     pff_sim_mmu },
+};
+
+#define NUM_POLICIES (sizeof(policies)/sizeof(policies[0]))
+
+#define MAX_LIST 64         // Max. values of a parameter
+#define MAX_RUNS 100        // Max. measured runs
+#define WRITE_BIT 0x80000000u
+
+// Synthetic access patterns, over 'pagesfactor' times as many
+// pages as frames: every page with the same probability, a loop
+// over all of them (the worst case of LRU and FIFO), or 80% of
+// the references to 20% of the pages
+
+static const char * patterns[] = { "uniform", "loop", "hotcold" };
+
+#define NUM_PATTERNS (sizeof(patterns)/sizeof(patterns[0]))
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    int numpol, numframes, numpat, numtraces;
+    const spolicy * pol[NUM_POLICIES];
+    int frames[MAX_LIST];
+    int pat[NUM_PATTERNS];
+    const char * trace[MAX_LIST];   // "ALG,INIT,N" or a file
+    int pagsz;              // Page size of the recorded traces
+    int pagesfactor;        // Pages per frame (synthetic)
+    unsigned long numrefs;  // References (synthetic)
+    int runs, warmup;
+    double maxseconds;      // Max. time of a run
+    unsigned tau;
+    unsigned seed;
+    char csv;
+}
+sparameters;
+
+// A trace in memory: element numbers, with the top bit set on
+// writes
+
+typedef struct
+{
+    char name[64];
+    unsigned * refs;
+    unsigned long numrefs;
+    int numpags, pagsz;
+}
+sbenchtrace;
+
+// Results of a configuration, sent by the child to its parent
+
+typedef struct
+{
+    int numruns;
+    char partial;           // 1 = some run hit --max-seconds
+    unsigned long numrefs;  // References of the (last) run
+    int numfaults;          // ...and its page faults
+    long maxrss;            // Peak RSS over that at the fork (KB)
+    double nsref[MAX_RUNS], nsfault[MAX_RUNS];
+}
+sresults;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// Generator of the synthetic traces (xorshift64*)
+
+static unsigned long long rnd_state;
+
+static unsigned rnd (void)
+{
+    rnd_state ^= rnd_state >> 12;
+    rnd_state ^= rnd_state << 25;
+    rnd_state ^= rnd_state >> 27;
+    return (rnd_state * 2685821657736338717ULL) >> 32;
+}
+
+static int make_pattern (sbenchtrace * B, const sparameters * P,
+                         int pat, int numframes)
+{
+    unsigned long i;
+    unsigned page, n, hot;
+
+    B->numpags = n = numframes * P->pagesfactor;
+    B->pagsz = 1;
+    B->numrefs = P->numrefs;
+    B->refs = (unsigned*) malloc (B->numrefs*sizeof(unsigned));
+    hot = n/5 ? n/5 : 1;
+    rnd_state = P->seed*0x9E3779B97F4A7C15ULL + 1;
+    snprintf (B->name, sizeof(B->name), "%s", patterns[pat]);
+
+    if (!B->refs)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (i=0; i<B->numrefs; i++)
+    {
+        switch (pat)
+        {
+        case 0:
+            page = rnd() % n;
+            break;
+        case 1:
+            page = i % n;
+            break;
+        default:
+            page = rnd()%10 < 8 ? rnd() % hot : rnd() % n;
+        }
+
+        B->refs[i] = i%4==3 ? page|WRITE_BIT : page;
+    }
+
+    return 0;
+}
+
+// Reads a recorded trace ("ALG,INIT,N" runs gen_trace) into
+// memory. Returns 0 if OK
+
+static int read_trace (sbenchtrace * B, const sparameters * P,
+                       const char * spec)
+{
+    strace T;
+    char alg[4], init[4], op, * c;
+    int numelem, r = 0;
+    unsigned long size = 1<<16;
+    unsigned u, * refs;
+
+    if (sscanf(spec,"%3[A-Z],%3[A-Z],%d",alg,init,&numelem)==3)
+        r = trace_open (&T, NULL, alg, init, numelem);
+    else
+        r = trace_open (&T, spec, NULL, NULL, 0);
+
+    if (r<0)
+        return -1;
+
+    // No commas in the name, that goes into the CSV
+    snprintf (B->name, sizeof(B->name), "%s", spec);
+
+    for (c=B->name; (c = strchr(c,',')); )
+        *c = '-';
+
+    B->pagsz = P->pagsz;
+    B->numpags = (T.totelem+P->pagsz-1) / P->pagsz;
+    B->numrefs = 0;
+    B->refs = (unsigned*) malloc (size*sizeof(unsigned));
+
+    while (B->refs && (r = trace_next(&T,&op,&u)) > 0)
+    {
+        if (B->numrefs==size)
+        {
+            size *= 2;
+            refs = (unsigned*) realloc (B->refs, size*sizeof(unsigned));
+
+            if (!refs)
+                free (B->refs);
+
+            B->refs = refs;
+
+            if (!refs)
+                break;
+        }
+
+        B->refs[B->numrefs++] = op=='W' ? u|WRITE_BIT : u;
+    }
+
+    if (!B->refs)
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+
+    if (trace_close(&T)<0 || !B->refs || r<0)
+    {
+        free (B->refs);
+        return -1;
+    }
+
+    return 0;
+}
+
+// One run of a policy over a trace. Returns the seconds it took
+// and leaves in *refs and *faults how far it got. If faulttime
+// isn't NULL, it also adds up there the seconds of the references
+// that caused a page fault
+
+static double run_once (const sparameters * P, const spolicy * pol,
+                        const sbenchtrace * B, int numframes,
+                        unsigned long * refs, int * faults,
+                        char * partial, double * faulttime)
+{
+    ssystem S;
+    unsigned long i;
+    unsigned u;
+    int before;
+    double start, t;
+
+    memset (&S, 0, sizeof(S));
+    S.pagsz = B->pagsz;
+    S.numpags = B->numpags;
+    S.numframes = numframes;
+    S.tau = P->tau;
+    S.pgt = (spage*) malloc (S.numpags*sizeof(spage));
+    S.frt = (sframe*) malloc (S.numframes*sizeof(sframe));
+
+    if (!S.pgt || !S.frt)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        exit (-1);
+    }
+
+    start = now ();
+    pol->init_tables (&S);
+
+    // In the child: the parent reports the run as failed
+    if (S.initerror)
+        exit (-1);
+
+    for (i=0; i<B->numrefs; i++)
+    {
+        u = B->refs[i];
+
+        if (faulttime)
+        {
+            // The fault is detected as in sim_pag_main.c
+            before = S.numpagefaults;
+            t = now ();
+            pol->sim_mmu (&S, u & ~WRITE_BIT, u & WRITE_BIT ? 'W' : 'R');
+
+            if (S.numpagefaults!=before)
+                *faulttime += now() - t;
+        }
+        else
+            pol->sim_mmu (&S, u & ~WRITE_BIT, u & WRITE_BIT ? 'W' : 'R');
+
+        // Look at the clock only once in a while
+        if (!(i & 4095) && i && now()-start > P->maxseconds)
+        {
+            *partial = 1;
+            i ++;
+            break;
+        }
+    }
+
+    t = now() - start;
+    *refs = i;
+    *faults = S.numpagefaults;
+
+    free (S.pgt);
+    free (S.frt);
+    free (S.window);
+
+    return t;
+}
+
+// Resident memory of the process now (in KB), or 0 if unknown
+
+static long current_rss (void)
+{
+    FILE * f = fopen ("/proc/self/statm", "r");
+    long size, resident = 0;
+
+    if (f)
+    {
+        if (fscanf(f,"%ld %ld",&size,&resident)!=2)
+            resident = 0;
+
+        fclose (f);
+    }
+
+    return resident * (sysconf(_SC_PAGESIZE)/1024);
+}
+
+// Runs a configuration in a child process and collects its
+// results. Returns 0 if OK
+
+static int run_config (const sparameters * P, const spolicy * pol,
+                       const sbenchtrace * B, int numframes,
+                       sresults * R)
+{
+    struct rusage usage;
+    long startrss;
+    int fd[2], status, r, faults;
+    unsigned long refs;
+    char partial;
+    pid_t pid;
+    double t, faulttime;
+    ssize_t n;
+
+    if (pipe(fd)<0 || (pid = fork())<0)
+    {
+        perror ("ERROR: can't start a run");
+        return -1;
+    }
+
+    if (!pid)
+    {
+        startrss = current_rss ();
+        close (fd[0]);
+        memset (R, 0, sizeof(*R));
+
+        for (r=0; r<P->warmup+P->runs; r++)
+        {
+            t = run_once (P, pol, B, numframes, &R->numrefs,
+                          &R->numfaults, &R->partial, NULL);
+
+            if (r<P->warmup)
+                continue;
+
+            faulttime = partial = 0;
+            run_once (P, pol, B, numframes, &refs, &faults, &partial,
+                      &faulttime);
+            R->partial |= partial;
+
+            R->nsref[R->numruns] = t*1e9 /
+                                   (R->numrefs ? R->numrefs : 1);
+            R->nsfault[R->numruns] = faults ?
+                                     faulttime*1e9 / faults : 0;
+            R->numruns ++;
+        }
+
+        getrusage (RUSAGE_SELF, &usage);
+        R->maxrss = usage.ru_maxrss - startrss;
+
+        n = write (fd[1], R, sizeof(*R));
+        _exit (n==sizeof(*R) ? 0 : 1);
+    }
+
+    close (fd[1]);
+    n = read (fd[0], R, sizeof(*R));
+    close (fd[0]);
+
+    if (waitpid(pid,&status,0)<0 || n!=sizeof(*R) ||
+        !WIFEXITED(status) || WEXITSTATUS(status))
+    {
+        fprintf (stderr, "ERROR: %s with %d frames on %s failed\n",
+                 pol->name, numframes, B->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Mean and half width of the 95% confidence interval (Student's
+// t for few runs)
+
+static void confidence (const double * x, int n, double * mean,
+                        double * half)
+{
+    static const double t975[] =
+    {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+        2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+        2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+        2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    double s = 0, var = 0;
+    int i;
+
+    for (i=0; i<n; i++)
+        s += x[i];
+
+    *mean = s/n;
+
+    for (i=0; i<n; i++)
+        var += (x[i]-*mean) * (x[i]-*mean);
+
+    if (n<2)
+    {
+        *half = 0;
+        return;
+    }
+
+    *half = (n-1<=30 ? t975[n-2] : 1.96) * sqrt(var/(n-1)/n);
+}
+
+static void print_result (const sparameters * P, const spolicy * pol,
+                          const sbenchtrace * B, int numframes,
+                          const sresults * R)
+{
+    double ref, refhalf, fault, faulthalf;
+
+    confidence (R->nsref, R->numruns, &ref, &refhalf);
+    confidence (R->nsfault, R->numruns, &fault, &faulthalf);
+
+    if (P->csv)
+        printf ("%s,%s,%d,%d,%lu,%d,%.3f,%.3f,%.3f,%.3f,%ld,%d\n",
+                pol->name, B->name, numframes, B->numpags,
+                R->numrefs, R->numfaults, ref, refhalf, fault,
+                faulthalf, R->maxrss, R->partial);
+    else
+        printf ("%-8s %-16s %8d %10lu %9d %10.1f +-%6.1f %10.1f "
+                "+-%6.1f %9ld%s\n", pol->name, B->name, numframes,
+                R->numrefs, R->numfaults, ref, refhalf, fault,
+                faulthalf, R->maxrss, R->partial ? " *" : "");
+
+    fflush (stdout);
+}
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    sbenchtrace * B;    // Traces to be simulated
+    sresults R;
+    int t, f, p, numtraces, ok = 1;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    // The recorded traces are read once; the synthetic ones are
+    // made for each number of frames
+    numtraces = P.numtraces + P.numpat;
+    B = (sbenchtrace*) calloc (numtraces, sizeof(sbenchtrace));
+
+    if (!B)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (t=0; t<P.numtraces; t++)
+        if (read_trace(&B[t],&P,P.trace[t])<0)
+            return -1;
+
+    if (P.csv)
+        printf ("policy,trace,frames,pages,references,faults,"
+                "ns_ref,ns_ref_ci95,ns_fault,ns_fault_ci95,"
+                "maxrss_kb,partial\n");
+    else
+        printf ("# %d measured runs after %d warm-up, at most %.1f s "
+                "each (* = cut short)\n#\n# %-6s %-16s %8s %10s %9s "
+                "%18s %18s %9s\n", P.runs, P.warmup, P.maxseconds,
+                "POLICY", "TRACE", "FRAMES", "REFS", "FAULTS",
+                "NS/REF (95%)", "NS/FAULT (95%)", "RSS(KB)");
+
+    for (f=0; f<P.numframes; f++)
+    {
+        for (t=P.numtraces; t<numtraces; t++)
+            if (make_pattern(&B[t],&P,P.pat[t-P.numtraces],
+                             P.frames[f])<0)
+                return -1;
+
+        for (t=0; t<numtraces; t++)
+        {
+            // Recorded traces: only while there is replacement
+            if (P.frames[f] >= B[t].numpags)
+                continue;
+
+            for (p=0; p<P.numpol; p++)
+                if (run_config(&P,P.pol[p],&B[t],P.frames[f],&R)<0)
+                    ok = 0;
+                else
+                    print_result (&P, P.pol[p], &B[t], P.frames[f],
+                                  &R);
+        }
+
+        for (t=P.numtraces; t<numtraces; t++)
+            free (B[t].refs);
+    }
+
+    for (t=0; t<P.numtraces; t++)
+        free (B[t].refs);
+
+    free (B);
+
+    return ok ? 0 : -1;
+}
+
+// Function that parses a list of numbers: "A,B,C", "A-B:S" (from
+// A to B in steps of S) or "A-B*M" (multiplying by M). Returns
+// the number of values or -1
+
+static int parse_numbers (const char * s, int v[], int min)
+{
+    int n = 0, a, b, step, len;
+    char kind;
+
+    for (;;)
+    {
+        kind = '+';
+        step = 1;
+
+        if (sscanf(s,"%d-%d%n",&a,&b,&len)==2)
+        {
+            if (s[len]==':' || s[len]=='*')
+            {
+                kind = s[len];
+                s += len+1;
+
+                if (sscanf(s,"%d%n",&step,&len)!=1)
+                    return -1;
+            }
+        }
+        else if (sscanf(s,"%d%n",&a,&len)==1)
+            b = a;
+        else
+            return -1;
+
+        s += len;
+
+        if (a<min || b<a || step<1 || (kind=='*' && step<2))
+            return -1;
+
+        for (; a<=b; a = kind=='*' ? a*step : a+step)
+        {
+            if (n==MAX_LIST)
+                return -1;
+
+            v[n++] = a;
+        }
+
+        if (*s=='\0')
+            return n;
+
+        if (*s++!=',')
+            return -1;
+    }
+}
+
+// Function that looks up a list of names separated by commas
+// (or "all") in a table. Returns how many there are or -1
+
+static int parse_names (const char * s, const char * const * table,
+                        int size, int stride, int v[])
+{
+    int n = 0, i, len;
+
+    if (!strcmp(s,"all"))
+    {
+        for (i=0; i<size; i++)
+            v[i] = i;
+
+        return size;
+    }
+
+    for (; *s; s += len + (s[len]==','))
+    {
+        len = strcspn (s, ",");
+
+        for (i=0; i<size; i++)
+        {
+            const char * name = *(const char * const *)
+                                ((const char *) table + i*stride);
+
+            if (strlen(name)==len && !strncmp(name,s,len))
+                break;
+        }
+
+        if (i==size || n==size)
+            return -1;
+
+        v[n++] = i;
+    }
+
+    return n ? n : -1;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i;
+
+    // Default parameters
+    p->numpol = 4;              // random, lru, fifo, fifo2ch
+    for (i=0; i<p->numpol; i++)
+        p->pol[i] = &policies[i];
+    p->numframes = parse_numbers ("16-1048576*4", p->frames, 1);
+    p->numpat = NUM_PATTERNS;
+    for (i=0; i<p->numpat; i++)
+        p->pat[i] = i;
+    p->numtraces = 0;
+    p->pagsz = 1;
+    p->pagesfactor = 2;
+    p->numrefs = 1000000;
+    p->runs = 5;
+    p->warmup = 1;
+    p->maxseconds = 1;
+    p->tau = 1000;
+    p->seed = 1;
+    p->csv = 0;
+
+    for (i=1, ok=1; i<argc; i++)
+        if (parse_option(argv[i],p)<0)
+            ok = 0;
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s [options]\n\n", argv[0]);
+
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--policy=LIST: random, lru, fifo, fifo2ch, ws,\n"
+             "\t        pff or all (random,lru,fifo,fifo2ch)\n"
+             "\t--frames=LIST: numbers of frames, as A,B,C,\n"
+             "\t        A-B:STEP or A-B*FACTOR (16-1048576*4)\n"
+             "\t--pattern=LIST: synthetic traces (uniform,\n"
+             "\t        loop, hotcold, all or none) (all)\n"
+             "\t--pages=N: pages per frame in them (2)\n"
+             "\t--refs=N: references of them (1000000)\n"
+             "\t--trace=ALG,INIT,N or --trace=FILE: recorded\n"
+             "\t        trace (may be repeated)...\n"
+             "\t--pagsz=N: ...with pages of N elements (1)\n"
+             "\t--runs=N: measured runs (5, max %d)\n"
+             "\t--warmup=N: runs before them (1)\n"
+             "\t--max-seconds=S: time limit of a run (1)\n"
+             "\t--tau=N: WS window / PFF threshold (1000)\n"
+             "\t--seed=N: seed of the synthetic traces (1)\n"
+             "\t--csv: write the results as CSV\n"
+             "\n", MAX_RUNS);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s --policy=lru,fifo --frames=16-65536*4\n"
+             "\t%s --pattern=none --trace=MER,RAN,10000 "
+             "--frames=16-4096*2\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok, v[NUM_POLICIES], i;
+
+    if (!strncmp(arg,"--policy=",9))
+    {
+        p->numpol = parse_names (arg+9, &policies[0].name,
+                                 NUM_POLICIES, sizeof(spolicy), v);
+
+        for (i=0; i<p->numpol; i++)
+            p->pol[i] = &policies[v[i]];
+
+        ok = p->numpol > 0;
+    }
+    else if (!strncmp(arg,"--frames=",9))
+        ok = (p->numframes = parse_numbers(arg+9,p->frames,1)) > 0;
+    else if (!strcmp(arg,"--pattern=none"))
+        ok = (p->numpat = 0) == 0;
+    else if (!strncmp(arg,"--pattern=",10))
+        ok = (p->numpat = parse_names(arg+10,patterns,NUM_PATTERNS,
+                                      sizeof(char*),p->pat)) > 0;
+    else if (!strncmp(arg,"--pages=",8))
+        ok = sscanf(arg+8,"%d",&p->pagesfactor)==1 &&
+             p->pagesfactor>=1;
+    else if (!strncmp(arg,"--refs=",7))
+        ok = sscanf(arg+7,"%lu",&p->numrefs)==1 && p->numrefs>0;
+    else if (!strncmp(arg,"--trace=",8))
+    {
+        ok = p->numtraces<MAX_LIST && arg[8];
+
+        if (ok)
+            p->trace[p->numtraces++] = arg+8;
+    }
+    else if (!strncmp(arg,"--pagsz=",8))
+        ok = sscanf(arg+8,"%d",&p->pagsz)==1 && p->pagsz>0;
+    else if (!strncmp(arg,"--runs=",7))
+        ok = sscanf(arg+7,"%d",&p->runs)==1 &&
+             p->runs>0 && p->runs<=MAX_RUNS;
+    else if (!strncmp(arg,"--warmup=",9))
+        ok = sscanf(arg+9,"%d",&p->warmup)==1 && p->warmup>=0;
+    else if (!strncmp(arg,"--max-seconds=",14))
+        ok = sscanf(arg+14,"%lf",&p->maxseconds)==1 &&
+             p->maxseconds>0;
+    else if (!strncmp(arg,"--tau=",6))
+        ok = sscanf(arg+6,"%u",&p->tau)==1 && p->tau>0;
+    else if (!strncmp(arg,"--seed=",7))
+        ok = sscanf(arg+7,"%u",&p->seed)==1;
+    else if (!strcmp(arg,"--csv"))
+        ok = p->csv = 1;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
@@ -0,0 +1,313 @@
+/*
+    sim_pag_ckpt.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "sim_paging.h"
+
+// A checkpoint file holds, in this order: the magic string,
+// the position in the trace, the ssystem structure (pointers
+// are meaningless there) and the arrays it points to: page
+// table, frames table, references and page faults of each page
+// and, if they exist, the WS window, the swap slots and the
+// regions and pages of the huge pages. Last come the positions
+// of the pointers of the random generator in its state (-1 if
+// there is no generator)
+
+#define CKPT_MAGIC "SIMPAG04"
+
+// Positions, in 32-bit words from the start of randomstate, of
+// the pointers of randomdata (which are only valid in the process
+// that saved them)
+
+static void random_offsets (ssystem * S, int32_t off[4])
+{
+    int32_t * base = (int32_t*) S->randomstate;
+    struct random_data * R = &S->randomdata;
+
+    if (!R->state)
+    {
+        off[0] = off[1] = off[2] = off[3] = -1;
+        return;
+    }
+
+    off[0] = R->fptr - base;
+    off[1] = R->rptr - base;
+    off[2] = R->state - base;
+    off[3] = R->end_ptr - base;
+}
+
+// Function that saves the state of the system
+
+int save_checkpoint (ssystem * S, const char * file,
+                     const sckptpos * pos)
+{
+    FILE * pf;
+    int32_t roff[4];
+    int ok;
+
+    random_offsets (S, roff);
+    pf = fopen (file, "wb");
+
+    if (!pf)
+    {
+        perror (file);
+        return -1;
+    }
+
+    ok = fwrite (CKPT_MAGIC, 8, 1, pf) == 1 &&
+         fwrite (pos, sizeof(*pos), 1, pf) == 1 &&
+         fwrite (S, sizeof(*S), 1, pf) == 1 &&
+         fwrite (S->pgt, sizeof(spage), S->numpags, pf)
+                == S->numpags &&
+         fwrite (S->frt, sizeof(sframe), S->numframes, pf)
+                == S->numframes &&
+         fwrite (S->pagerefs, sizeof(unsigned), S->numpags, pf)
+                == S->numpags &&
+         fwrite (S->pagefaults, sizeof(unsigned), S->numpags, pf)
+                == S->numpags;
+
+    if (ok && S->window)
+        ok = fwrite (S->window, sizeof(int), S->tau, pf) == S->tau;
+
+    if (ok && S->swap.enabled)
+        ok = fwrite (S->swap.slot, sizeof(int), S->numpags, pf)
+             == S->numpags;
+
+    if (ok && S->huge.factor)
+        ok = fwrite (S->huge.promoted, 1, S->huge.numregions, pf)
+             == S->huge.numregions &&
+             fwrite (S->huge.touched, 1, S->numpags, pf)
+             == S->numpags;
+
+    if (ok)
+        ok = fwrite (roff, sizeof(roff), 1, pf) == 1;
+
+    if (fclose(pf)==EOF)
+        ok = 0;
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "ERROR while writing checkpoint %s\n", file);
+    return -1;
+}
+
+// Function that restores the state of the system on top of the
+// tables already initialized by init_tables. The page size and
+// the trace must be the same, but the simulation may go on
+// with more frames (which are added to the free list), with
+// another replacement policy or with other options (detailed
+// mode, swap device, prefetching...). WS can only go on from a
+// checkpoint of WS with the same window, and the huge pages from
+// one with huge pages of the same size and the same TLB
+
+int load_checkpoint (ssystem * S, const char * file,
+                     sckptpos * pos)
+{
+    FILE * pf;
+    ssystem C;     // System as it was saved
+    char magic[8];
+    int32_t roff[4];
+    int ok, f;
+
+    pf = fopen (file, "rb");
+
+    if (!pf)
+    {
+        perror (file);
+        return -1;
+    }
+
+    ok = fread (magic, 8, 1, pf) == 1 &&
+         !memcmp (magic, CKPT_MAGIC, 8) &&
+         fread (pos, sizeof(*pos), 1, pf) == 1 &&
+         fread (&C, sizeof(C), 1, pf) == 1;
+
+    if (ok && (C.pagsz!=S->pagsz || C.numpags!=S->numpags ||
+               C.numframes>S->numframes))
+    {
+        fprintf (stderr, "ERROR: checkpoint %s was taken with "
+                         "%d pages of %d elements and %d frames\n",
+                 file, C.numpags, C.pagsz, C.numframes);
+        fclose (pf);
+        return -1;
+    }
+
+    // The pages of WS leave the frames when they leave the window,
+    // so without the same window they would stay there forever
+    if (ok && S->window && (!C.window || C.tau!=S->tau))
+    {
+        fprintf (stderr, "ERROR: checkpoint %s was not taken with "
+                         "WS and a window of %u references\n",
+                 file, S->tau);
+        fclose (pf);
+        return -1;
+    }
+
+    // The regions already collapsed would not match
+    if (ok && S->huge.factor && C.huge.factor &&
+        (C.huge.factor!=S->huge.factor ||
+         C.huge.tlbsize!=S->huge.tlbsize))
+    {
+        fprintf (stderr, "ERROR: checkpoint %s was taken with huge "
+                         "pages of %d pages and a TLB of %d entries\n",
+                 file, C.huge.factor, C.huge.tlbsize);
+        fclose (pf);
+        return -1;
+    }
+
+    ok = ok &&
+         fread (S->pgt, sizeof(spage), S->numpags, pf)
+               == S->numpags &&
+         fread (S->frt, sizeof(sframe), C.numframes, pf)
+               == C.numframes &&
+         fread (S->pagerefs, sizeof(unsigned), S->numpags, pf)
+               == S->numpags &&
+         fread (S->pagefaults, sizeof(unsigned), S->numpags, pf)
+               == S->numpags;
+
+    // The window is skipped if the policy has none
+    if (ok && C.window)
+    {
+        if (S->window)
+            ok = fread (S->window, sizeof(int), C.tau, pf) == C.tau;
+        else
+            ok = fseek (pf, C.tau*sizeof(int), SEEK_CUR) == 0;
+    }
+
+    if (ok && C.swap.enabled)
+    {
+        if (S->swap.enabled)
+            ok = fread (S->swap.slot, sizeof(int), S->numpags, pf)
+                 == S->numpags;
+        else
+            ok = fseek (pf, S->numpags*sizeof(int), SEEK_CUR) == 0;
+    }
+
+    if (ok && C.huge.factor)
+    {
+        if (S->huge.factor)
+            ok = fread (S->huge.promoted, 1, S->huge.numregions, pf)
+                 == S->huge.numregions &&
+                 fread (S->huge.touched, 1, S->numpags, pf)
+                 == S->numpags;
+        else
+            ok = fseek (pf, C.huge.numregions+S->numpags, SEEK_CUR) == 0;
+    }
+
+    ok = ok && fread (roff, sizeof(roff), 1, pf) == 1;
+
+    fclose (pf);
+
+    if (!ok)
+    {
+        fprintf (stderr, "ERROR while reading checkpoint %s\n", file);
+        return -1;
+    }
+
+    // Counters and state of the policies
+    S->lru = C.lru;
+    S->clock = C.clock;
+    S->listfree = C.listfree;
+    S->listoccupied = C.listoccupied;
+    S->numrefsread = C.numrefsread;
+    S->numrefswrite = C.numrefswrite;
+    S->numpagefaults = C.numpagefaults;
+    S->numpgwriteback = C.numpgwriteback;
+    S->numillegalrefs = C.numillegalrefs;
+    S->lastfault = C.lastfault;
+    S->maxresident = C.maxresident;
+    S->spacetime = C.spacetime;
+
+    // The random generator goes on from the same state, with its
+    // pointers moved to the randomstate of this process
+    if (S->randomdata.state && roff[2]!=-1)
+    {
+        int32_t * base = (int32_t*) S->randomstate;
+
+        memcpy (S->randomstate, C.randomstate, sizeof(S->randomstate));
+        S->randomdata = C.randomdata;
+        S->randomdata.fptr = base + roff[0];
+        S->randomdata.rptr = base + roff[1];
+        S->randomdata.state = base + roff[2];
+        S->randomdata.end_ptr = base + roff[3];
+    }
+
+    if (S->swap.enabled && C.swap.enabled)
+    {
+        S->swap.nextslot = C.swap.nextslot;
+        S->swap.hand = C.swap.hand % S->numframes;
+        S->swap.now = C.swap.now;
+        S->swap.busyuntil = C.swap.busyuntil;
+        S->swap.stall = C.swap.stall;
+        S->swap.numreads = C.swap.numreads;
+        S->swap.numwrites = C.swap.numwrites;
+        S->swap.numcleaned = C.swap.numcleaned;
+        S->swap.numclusters = C.swap.numclusters;
+    }
+
+    // Huge pages and TLBs as they were, with the period and the
+    // regions per pass of this run
+    if (S->huge.factor && C.huge.factor)
+    {
+        C.huge.period = S->huge.period;
+        C.huge.scan = S->huge.scan;
+        C.huge.promoted = S->huge.promoted;
+        C.huge.touched = S->huge.touched;
+
+        if (C.huge.countdown > C.huge.period)
+            C.huge.countdown = C.huge.period;
+
+        S->huge = C.huge;
+    }
+
+    if (S->prefetch.depth && C.prefetch.depth)
+    {
+        C.prefetch.depth = S->prefetch.depth;
+        S->prefetch = C.prefetch;
+    }
+
+    // The frames added go to the end of the free list
+    for (f=C.numframes; f<S->numframes; f++)
+    {
+        S->frt[f].page = -1;
+
+        if (S->listfree==-1)
+            S->frt[f].next = f;
+        else
+        {
+            S->frt[f].next = S->frt[S->listfree].next;
+            S->frt[S->listfree].next = f;
+        }
+
+        S->listfree = f;
+    }
+
+    // If the checkpoint comes from a policy that doesn't keep the
+    // list of occupied frames (FIFO), build it in frame order
+    for (f=0, S->numresident=0; f<S->numframes; f++)
+        if (S->frt[f].page!=-1)
+        {
+            S->numresident ++;
+
+            if (C.listoccupied==-1)
+            {
+                if (S->listoccupied==-1)
+                    S->frt[f].next = f;
+                else
+                {
+                    S->frt[f].next = S->frt[S->listoccupied].next;
+                    S->frt[S->listoccupied].next = f;
+                }
+
+                S->listoccupied = f;
+            }
+        }
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+    sim_pag_decode.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_paging.h"
+
+// Shows the binary log written by a simulator with --events=FILE
+// in the same format as the detailed mode
+
+#define NUM_EVENTS 4096     // Events read at a time
+
+int main (int argc, char * argv[])
+{
+    static sevent ev[NUM_EVENTS];
+    char magic[8];
+    int pagsz;
+    size_t i, n;
+    FILE * pf;
+
+    if (argc!=2)
+    {
+        fprintf (stderr, "\n    USAGE:\n\t%s eventfile\n\n", argv[0]);
+        return -1;
+    }
+
+    pf = fopen (argv[1], "rb");
+
+    if (!pf)
+    {
+        fprintf (stderr, "ERROR: can't open '%s'\n", argv[1]);
+        return -1;
+    }
+
+    if (fread(magic,sizeof(magic),1,pf)!=1 ||
+        memcmp(magic,"SIMEVT01",sizeof(magic)) ||
+        fread(&pagsz,sizeof(pagsz),1,pf)!=1 || pagsz<1)
+    {
+        fprintf (stderr, "ERROR: '%s' is not an event log\n", argv[1]);
+        fclose (pf);
+        return -1;
+    }
+
+    while ((n = fread(ev,sizeof(sevent),NUM_EVENTS,pf)) > 0)
+        for (i=0; i<n; i++)
+            print_event (stdout, &ev[i], pagsz);
+
+    if (ferror(pf))
+    {
+        fprintf (stderr, "ERROR: can't read '%s'\n", argv[1]);
+        fclose (pf);
+        return -1;
+    }
+
+    fclose (pf);
+    return 0;
+}
@@ -0,0 +1,397 @@
+/*
+    sim_pag_events.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "sim_paging.h"
+
+// Events are kept in a ring shared by the simulator (producer)
+// and a writer thread (consumer) that dumps them to the file.
+// The simulator only blocks if the ring is full
+
+#define RING_SIZE  (1<<16)      // Events in the ring (power of 2)
+#define CHUNK_SIZE 4096         // Events per wake-up of the writer
+
+static const char magic[8] = "SIMEVT01";
+
+struct sevlog
+{
+    FILE * pf;
+    sevent ring[RING_SIZE];
+    atomic_uint head;           // Next event to be stored
+    atomic_uint tail;           // Next event to be written
+    int done;                   // 1 = no more events will come
+    int error;                  // 1 = some write failed
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t more;        // There are events to be written
+    pthread_cond_t room;        // There is room in the ring
+};
+
+// Function that renders an event exactly as the detailed mode
+// has always shown it
+
+void print_event (FILE * f, const sevent * e, int pagsz)
+{
+    switch (e->type)
+    {
+    case EV_ACCESS:
+        fprintf (f, "\t%c %u == P%d(F%d) + %d\n", e->flag,
+                 (unsigned) e->a, (int) ((unsigned) e->a / pagsz),
+                 e->b, (int) ((unsigned) e->a % pagsz));
+        break;
+    case EV_FAULT:
+        fprintf (f, "@ PAGE_FAULT in P %d!\n", e->a);
+        break;
+    case EV_CHOOSE:
+        switch (e->flag)
+        {
+        case 'R':
+            fprintf (f, "@ Choosing (at random) P%d of F%d to be "
+                     "replaced\n", e->a, e->b);
+            break;
+        case 'L':
+            fprintf (f, "@ LRU chooses P%d in F%d (ts=%d)\n",
+                     e->a, e->b, e->c);
+            break;
+        case 'F':
+            fprintf (f, "@ Choosing by FIFO P%d of F%d to be "
+                     "replaced\n", e->a, e->b);
+            break;
+        case '2':
+            fprintf (f, "@ FIFO 2C chooses P%d (F%d)\n", e->a, e->b);
+            break;
+        case 'W':
+            fprintf (f, "@ Working set doesn't fit: choosing LRU P%d "
+                     "of F%d to be replaced\n", e->a, e->b);
+            break;
+        default:
+            fprintf (f, "@ No free frames: choosing LRU P%d of F%d "
+                     "to be replaced\n", e->a, e->b);
+        }
+        break;
+    case EV_WRITEBACK:
+        if (e->flag)
+            fprintf (f, "@ Writing modified P%d back (to disc)\n", e->a);
+        else
+            fprintf (f, "@ Writing modified P%d back (to disc) to "
+                     "replace it\n", e->a);
+        break;
+    case EV_REPLACE:
+        fprintf (f, "@ Replacing victim P%d with P%d in F%d\n",
+                 e->a, e->b, e->c);
+        break;
+    case EV_STORE:
+        fprintf (f, "@ Storing P%d in F%d\n", e->a, e->b);
+        break;
+    case EV_RELEASE:
+        fprintf (f, "@ Releasing P%d from F%d\n", e->a, e->b);
+        break;
+    case EV_CLOCK:
+        fprintf (f, "@ WARNING: clock overflow!%s\n",
+                 e->flag=='N' ? " Normalizing timestamps..." : "");
+        break;
+    case EV_PFF:
+        fprintf (f, "@ PFF: %u references since last fault (%s)\n",
+                 (unsigned) e->a, e->b ? "shrinking" : "growing");
+        break;
+    case EV_CLEAN:
+        fprintf (f, "@ Pageout daemon cleans P%d of F%d\n", e->a, e->b);
+        break;
+    case EV_PREFETCH:
+        fprintf (f, "@ Prefetching %d pages of the stream with "
+                 "stride %d\n", e->a, e->b);
+        break;
+    case EV_UNUSED:
+        fprintf (f, "@ P%d was prefetched but never used\n", e->a);
+        break;
+    case EV_PROMOTE:
+        fprintf (f, "@ Collapsing P%d-P%d into a huge page\n",
+                 e->a, e->a+e->b-1);
+        break;
+    case EV_SPLIT:
+        fprintf (f, "@ Splitting the huge page of P%d to evict P%d\n",
+                 e->a, e->b);
+        break;
+    default:
+        fprintf (f, "@ Unknown event %d\n", e->type);
+    }
+}
+
+// Groups of events that can be selected with --detail-events
+
+static const struct
+{
+    const char * name;
+    unsigned types;
+}
+groups[] =
+{
+    { "access",   1<<EV_ACCESS },
+    { "fault",    1<<EV_FAULT },
+    { "evict",    1<<EV_CHOOSE | 1<<EV_WRITEBACK | 1<<EV_REPLACE |
+                  1<<EV_RELEASE | 1<<EV_CLEAN },
+    { "load",     1<<EV_STORE },
+    { "prefetch", 1<<EV_PREFETCH | 1<<EV_UNUSED },
+    { "policy",   1<<EV_CLOCK | 1<<EV_PFF },
+    { "huge",     1<<EV_PROMOTE | 1<<EV_SPLIT },
+};
+
+#define NUM_GROUPS (sizeof(groups)/sizeof(groups[0]))
+
+// Function that turns a list of groups separated by commas
+// (e.g. "fault,evict") into a set of event types. Returns 1 if OK
+
+int parse_event_types (const char * list, unsigned * types)
+{
+    const char * p;
+    size_t len, g;
+
+    *types = 0;
+
+    for (p=list; *p; p+=len+(p[len]==','))
+    {
+        len = strcspn (p, ",");
+
+        for (g=0; g<NUM_GROUPS; g++)
+            if (strlen(groups[g].name)==len &&
+                !strncmp(groups[g].name,p,len))
+                break;
+
+        if (g==NUM_GROUPS)
+            return 0;
+
+        *types |= groups[g].types;
+    }
+
+    return *types != 0;
+}
+
+// Checks whether the event passes the filter of the detailed mode
+
+static int event_wanted (ssystem * S, const sevent * e)
+{
+    sevfilter * F = &S->evfilter;
+    int page;
+
+    if (!(F->types & 1u<<e->type))
+        return 0;
+
+    switch (e->type)
+    {
+    case EV_ACCESS:
+        page = (unsigned) e->a / S->pagsz;
+        break;
+    case EV_REPLACE:        // Either the victim or the new page
+        if (e->b>=F->firstpage && e->b<=F->lastpage)
+            return 1;
+        page = e->a;
+        break;
+    case EV_FAULT:
+    case EV_CHOOSE:
+    case EV_WRITEBACK:
+    case EV_STORE:
+    case EV_RELEASE:
+    case EV_CLEAN:
+    case EV_UNUSED:
+    case EV_PROMOTE:
+    case EV_SPLIT:
+        page = e->a;
+        break;
+    default:                // Not about a page
+        return 1;
+    }
+
+    return page>=F->firstpage && page<=F->lastpage;
+}
+
+// Function called by the simulator for every event of the
+// detailed mode. Without a log, the event is shown right away
+
+void sim_event (ssystem * S, int type, int flag, int a, int b, int c)
+{
+    struct sevlog * L = S->evlog;
+    sevent e;
+    unsigned h;
+
+    e.type = type;
+    e.flag = flag;
+    e.unused = 0;
+    e.a = a;
+    e.b = b;
+    e.c = c;
+
+    if (S->evfilter.on && !event_wanted(S,&e))
+        return;
+
+    if (!L)
+    {
+        print_event (stdout, &e, S->pagsz);
+        return;
+    }
+
+    h = atomic_load_explicit (&L->head, memory_order_relaxed);
+
+    if (h - atomic_load_explicit (&L->tail, memory_order_acquire)
+        == RING_SIZE)
+    {
+        pthread_mutex_lock (&L->lock);
+
+        while (h - atomic_load (&L->tail) == RING_SIZE)
+        {
+            pthread_cond_signal (&L->more);
+            pthread_cond_wait (&L->room, &L->lock);
+        }
+
+        pthread_mutex_unlock (&L->lock);
+    }
+
+    L->ring[h % RING_SIZE] = e;
+    atomic_store_explicit (&L->head, h+1, memory_order_release);
+
+    if ((h+1) % CHUNK_SIZE == 0)
+    {
+        pthread_mutex_lock (&L->lock);
+        pthread_cond_signal (&L->more);
+        pthread_mutex_unlock (&L->lock);
+    }
+}
+
+// Writer thread: waits for events and writes them to the file
+// in as few fwrite calls as possible
+
+static void * writer_thread (void * arg)
+{
+    struct sevlog * L = arg;
+    unsigned h, t, n;
+
+    for (;;)
+    {
+        pthread_mutex_lock (&L->lock);
+
+        while (atomic_load (&L->head) == atomic_load (&L->tail) &&
+               !L->done)
+            pthread_cond_wait (&L->more, &L->lock);
+
+        pthread_mutex_unlock (&L->lock);
+
+        h = atomic_load_explicit (&L->head, memory_order_acquire);
+        t = atomic_load_explicit (&L->tail, memory_order_relaxed);
+
+        if (h == t)
+            break;                  // done and nothing left
+
+        while (t != h)
+        {
+            // Up to the end of the ring, or up to the head
+            n = RING_SIZE - t % RING_SIZE;
+
+            if (n > h - t)
+                n = h - t;
+
+            if (fwrite (&L->ring[t % RING_SIZE], sizeof(sevent), n,
+                        L->pf) != n)
+                L->error = 1;
+
+            t += n;
+        }
+
+        atomic_store_explicit (&L->tail, t, memory_order_release);
+
+        pthread_mutex_lock (&L->lock);
+        pthread_cond_signal (&L->room);
+        pthread_mutex_unlock (&L->lock);
+    }
+
+    return NULL;
+}
+
+// Function that sends the events to 'file' instead of stdout.
+// Returns 1 if OK
+
+int open_event_log (ssystem * S, const char * file)
+{
+    struct sevlog * L;
+    int pagsz = S->pagsz;
+
+    L = (struct sevlog *) malloc (sizeof(struct sevlog));
+
+    if (!L)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return 0;
+    }
+
+    L->pf = fopen (file, "wb");
+
+    if (!L->pf)
+    {
+        fprintf (stderr, "ERROR: can't create '%s'\n", file);
+        free (L);
+        return 0;
+    }
+
+    if (fwrite (magic, sizeof(magic), 1, L->pf) != 1 ||
+        fwrite (&pagsz, sizeof(pagsz), 1, L->pf) != 1)
+    {
+        fprintf (stderr, "ERROR: can't write '%s'\n", file);
+        fclose (L->pf);
+        free (L);
+        return 0;
+    }
+
+    atomic_init (&L->head, 0);
+    atomic_init (&L->tail, 0);
+    L->done = L->error = 0;
+    pthread_mutex_init (&L->lock, NULL);
+    pthread_cond_init (&L->more, NULL);
+    pthread_cond_init (&L->room, NULL);
+
+    if (pthread_create (&L->writer, NULL, writer_thread, L))
+    {
+        fprintf (stderr, "ERROR: can't start the event writer\n");
+        fclose (L->pf);
+        free (L);
+        return 0;
+    }
+
+    S->evlog = L;
+    return 1;
+}
+
+// Function that writes the pending events and closes the log.
+// Returns 1 if every event was written
+
+int close_event_log (ssystem * S)
+{
+    struct sevlog * L = S->evlog;
+    int ok;
+
+    if (!L)
+        return 1;
+
+    pthread_mutex_lock (&L->lock);
+    L->done = 1;
+    pthread_cond_signal (&L->more);
+    pthread_mutex_unlock (&L->lock);
+
+    pthread_join (L->writer, NULL);
+
+    ok = !L->error;
+
+    if (fclose (L->pf))
+        ok = 0;
+
+    pthread_mutex_destroy (&L->lock);
+    pthread_cond_destroy (&L->more);
+    pthread_cond_destroy (&L->room);
+    free (L);
+    S->evlog = NULL;
+
+    return ok;
+}
@@ -9,6 +9,9 @@
 
 #include "./sim_paging.h"
 
+static int load_page(ssystem* S, int page, const int keep[], int nkeep);
+static int next_victim(ssystem* S);
+
 // Function that initialises the tables
 
 void init_tables(ssystem* S) {
@@ -60,12 +63,14 @@ unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
     frame = S->pgt[page].frame;
     physical_addr = frame * S->pagsz + offset;
 
+    if (S->pgt[page].prefetched)
+        prefetch_used(S, page);
+
     // Simular la referencia (contadores, modified, etc.)
     reference_page(S, page, op);
 
     if (S->detailed) {
-        printf("\t%c %u == P%d(F%d) + %d\n",
-               op, virtual_addr, page, frame, offset);
+        sim_event(S, EV_ACCESS, op, virtual_addr, frame, 0);
     }
 
     return physical_addr;
@@ -87,14 +92,36 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
   // TODO(student):
   //       Type in the code that simulates the Operating
   //
-    int page, victim, frame, last;
+    int page, i, n;
+    int batch[PREFETCH_MAX_DEPTH + 1];
 
     S->numpagefaults ++;
     page = virtual_address / S-> pagsz;
     if (S->detailed) {
-        printf ("@ PAGE_FAULT in P %d!\n", page);
+        sim_event (S, EV_FAULT, 0, page, 0, 0);
     }
 
+    pageout_daemon(S);
+
+    load_page(S, page, NULL, 0);
+
+    // Load ahead the next pages of the stream, if any, but
+    // never at the expense of the page that caused the fault
+    // or of the pages loaded ahead before them
+    batch[0] = page;
+    n = prefetch_candidates(S, page, batch + 1);
+
+    for (i = 1; i <= n && load_page(S, batch[i], batch, i) == 0; i++)
+        prefetch_loaded(S, batch[i]);
+}
+
+// Loads the page in a free frame or, if there are none, in the
+// frame of a victim. Fails, before the policy changes anything,
+// if the victim would be one of the nkeep pages of keep[]
+
+static int load_page(ssystem* S, int page, const int keep[], int nkeep) {
+    int victim, frame, last, k;
+
     if (S->listfree != -1) {
 	// There are free frames
         last = S->listfree;
@@ -111,9 +138,18 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
         occupy_free_frame(S, frame, page);
     }else {
 	// There are not free frames
+        if (nkeep) {
+            victim = next_victim(S);
+            for (k = 0; k < nkeep; k++)
+                if (victim == keep[k]) return -1;
+        }
+        PROFILE_START(S, policymark);
         victim = choose_page_to_be_replaced(S);
+        PROFILE_STOP(S, policymark, PROF_CHOOSE);
         replace_page(S, victim, page);
     }
+
+    return 0;
 }
 
 int choose_page_to_be_replaced(ssystem* S) {
@@ -121,30 +157,36 @@ int choose_page_to_be_replaced(ssystem* S) {
   int frame = S->frt[S->listoccupied].next;
 
   if (S->detailed)
-    printf(
-        "@ Choosing by FIFO P%d of F%d to be "
-        "replaced\n",
-        S->frt[frame].page, frame);
+    sim_event(S, EV_CHOOSE, 'F', S->frt[frame].page, frame, 0);
 
   return S->frt[frame].page;
 }
 
+// Page that choose_page_to_be_replaced would return, without
+// changing anything
+
+static int next_victim(ssystem* S) {
+  return S->frt[S->frt[S->listoccupied].next].page;
+}
+
 void replace_page(ssystem* S, int victim, int newpage) {
 
   int frame = S->pgt[victim].frame;
 
+  if (S->pgt[victim].prefetched) prefetch_evicted(S, victim);
+
   if (S->pgt[victim].modified) {
     if (S->detailed)
-      printf(
-          "@ Writing modified P%d back (to disc) to "
-          "replace it\n",
-          victim);
+      sim_event(S, EV_WRITEBACK, 0, victim, 0, 0);
 
+    swap_write(S, victim);
     S->numpgwriteback++;
   }
 
   if (S->detailed)
-    printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
+    sim_event(S, EV_REPLACE, 0, victim, newpage, frame);
+
+  huge_evicted(S, victim);
 
   S->pgt[victim].present = 0;
 
@@ -155,16 +197,16 @@ void replace_page(ssystem* S, int victim, int newpage) {
 
   S->frt[frame].page = newpage;
 
-  S->frt[frame].next            = S->frt[S->listoccupied].next; // primero actual
-  S->frt[S->listoccupied].next  = frame;                        // ltimo -> nuevo
-  S->listoccupied               = frame;                        // nuevo ltimo
-    }
+  swap_read(S, newpage);
+
+  // The victim's frame was the first one: it becomes the last
+  S->listoccupied = frame;
 }
 
 void occupy_free_frame(ssystem* S, int frame, int page) {
 
     if (S->detailed)
-        printf("@ Storing P%d in F%d\n", page, frame);
+        sim_event(S, EV_STORE, 0, page, frame, 0);
 
     // 1. Actualizar la tabla de pginas
     S->pgt[page].frame      = frame;
@@ -175,6 +217,8 @@ void occupy_free_frame(ssystem* S, int frame, int page) {
     // 2. Actualizar la tabla de frames
     S->frt[frame].page = page;
 
+    swap_read(S, page);
+
     // 3. Insertar el frame en la lista de ocupados (FIFO)
     if (S->listoccupied == -1) {
         // Lista vaca: el frame se apunta a s mismo
@@ -234,5 +278,5 @@ void print_replacement_report(ssystem* S) {
 
     printf("FIFO replacement\n");
     printf("Next victim will be: frame %d (page %d)\n",
-           victim_frame, victim_page);
+           victim_frame, page_number(S, victim_page));
 }
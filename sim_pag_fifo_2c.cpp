@@ -9,6 +9,9 @@
 
 #include "./sim_paging.h"
 
+static int load_page(ssystem* S, int page, const int keep[], int nkeep);
+static int next_victim(ssystem* S);
+
 // Function that initialises the tables
 
 void init_tables(ssystem* S) {
@@ -60,12 +63,14 @@ unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
     frame = S->pgt[page].frame;
     physical_addr = frame * S->pagsz + offset;
 
+    if (S->pgt[page].prefetched)
+        prefetch_used(S, page);
+
     // Simular la referencia (contadores, modified, etc.)
     reference_page(S, page, op);
 
     if (S->detailed) {
-        printf("\t%c %u == P%d(F%d) + %d\n",
-               op, virtual_addr, page, frame, offset);
+        sim_event(S, EV_ACCESS, op, virtual_addr, frame, 0);
     }
 
     return physical_addr;
@@ -79,6 +84,8 @@ void reference_page(ssystem* S, int page, char op) {
     S->pgt[page].modified = 1;  // count it and mark the
     S->numrefswrite++;          // page 'modified'
   }
+
+  S->pgt[page].referenced = 1;  // Second chance when chosen
 }
 
 // Functions that simulate the operating system
@@ -87,14 +94,36 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
   // TODO(student):
   //       Type in the code that simulates the Operating
   //
-    int page, victim, frame, last;
+    int page, i, n;
+    int batch[PREFETCH_MAX_DEPTH + 1];
 
     S->numpagefaults ++;
     page = virtual_address / S-> pagsz;
     if (S->detailed) {
-        printf ("@ PAGE_FAULT in P %d!\n", page);
+        sim_event (S, EV_FAULT, 0, page, 0, 0);
     }
 
+    pageout_daemon(S);
+
+    load_page(S, page, NULL, 0);
+
+    // Load ahead the next pages of the stream, if any, but
+    // never at the expense of the page that caused the fault
+    // or of the pages loaded ahead before them
+    batch[0] = page;
+    n = prefetch_candidates(S, page, batch + 1);
+
+    for (i = 1; i <= n && load_page(S, batch[i], batch, i) == 0; i++)
+        prefetch_loaded(S, batch[i]);
+}
+
+// Loads the page in a free frame or, if there are none, in the
+// frame of a victim. Fails, before the policy changes anything,
+// if the victim would be one of the nkeep pages of keep[]
+
+static int load_page(ssystem* S, int page, const int keep[], int nkeep) {
+    int victim, frame, last, k;
+
     if (S->listfree != -1) {
 	// There are free frames
         last = S->listfree;
@@ -111,9 +140,18 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
         occupy_free_frame(S, frame, page);
     }else {
 	// There are not free frames
+        if (nkeep) {
+            victim = next_victim(S);
+            for (k = 0; k < nkeep; k++)
+                if (victim == keep[k]) return -1;
+        }
+        PROFILE_START(S, policymark);
         victim = choose_page_to_be_replaced(S);
+        PROFILE_STOP(S, policymark, PROF_CHOOSE);
         replace_page(S, victim, page);
     }
+
+    return 0;
 }
 
 int choose_page_to_be_replaced(ssystem* S) {
@@ -130,7 +168,7 @@ int choose_page_to_be_replaced(ssystem* S) {
         if (S->pgt[page].referenced == 0) {
             // vctima encontrada
             if (S->detailed)
-                printf("@ FIFO 2C chooses P%d (F%d)\n", page, frame);
+                sim_event(S, EV_CHOOSE, '2', page, frame, 0);
             return page;   // devuelve PGINA
         }
         // segunda oportunidad
@@ -138,8 +176,30 @@ int choose_page_to_be_replaced(ssystem* S) {
         // rotacin
         current = frame;
     }
-    // si todas estaban referenced (raro), devolvemos la primera
-    return S->frt[S->listoccupied].next;
+    // si todas estaban referenced, devolvemos la pgina del primero
+    // (ya con el bit a 0): FIFO puro
+    frame = S->frt[S->listoccupied].next;
+    page = S->frt[frame].page;
+
+    if (S->detailed)
+        sim_event(S, EV_CHOOSE, '2', page, frame, 0);
+
+    return page;
+}
+
+// Page that choose_page_to_be_replaced would return, without
+// clearing any reference bit: the first one without it or, if
+// all of them have it, the first one
+
+static int next_victim(ssystem* S) {
+    int frame = S->frt[S->listoccupied].next;
+
+    for (int i = 0; i < S->numframes; i++) {
+        if (S->pgt[S->frt[frame].page].referenced == 0)
+            return S->frt[frame].page;
+        frame = S->frt[frame].next;
+    }
+    return S->frt[S->frt[S->listoccupied].next].page;
 }
 
 
@@ -147,15 +207,19 @@ void replace_page(ssystem* S, int victim, int newpage) {
 
     int frame = S->pgt[victim].frame;
 
+    if (S->pgt[victim].prefetched) prefetch_evicted(S, victim);
+
     if (S->pgt[victim].modified) {
         if (S->detailed)
-            printf("@ Writing modified P%d back\n", victim);
+            sim_event(S, EV_WRITEBACK, 0, victim, 0, 0);
+        swap_write(S, victim);
         S->numpgwriteback++;
     }
 
     if (S->detailed)
-        printf("@ Replacing victim P%d with P%d in F%d\n",
-               victim, newpage, frame);
+        sim_event(S, EV_REPLACE, 0, victim, newpage, frame);
+
+    huge_evicted(S, victim);
 
     S->pgt[victim].present = 0;
 
@@ -166,6 +230,8 @@ void replace_page(ssystem* S, int victim, int newpage) {
 
     S->frt[frame].page = newpage;
 
+    swap_read(S, newpage);
+
     S->listoccupied = frame;
 
 }
@@ -174,7 +240,7 @@ void replace_page(ssystem* S, int victim, int newpage) {
 void occupy_free_frame(ssystem* S, int frame, int page) {
 
     if (S->detailed)
-        printf("@ Storing P%d in F%d\n", page, frame);
+        sim_event(S, EV_STORE, 0, page, frame, 0);
 
     // 1. Actualizar la tabla de pginas
     S->pgt[page].frame      = frame;
@@ -185,6 +251,8 @@ void occupy_free_frame(ssystem* S, int frame, int page) {
     // 2. Actualizar la tabla de frames
     S->frt[frame].page = page;
 
+    swap_read(S, page);
+
     // 3. Insertar el frame en la lista de ocupados (FIFO)
     if (S->listoccupied == -1) {
         // Lista vaca: el frame se apunta a s mismo
@@ -266,7 +334,7 @@ void print_replacement_report(ssystem* S) {
         int p = S->frt[f].page;
         printf("%8d   %8d   %6d\n",
                f,
-               p,
+               page_number(S, p),
                S->pgt[p].referenced);
         f = S->frt[f].next;
     }
@@ -278,6 +346,6 @@ void print_replacement_report(ssystem* S) {
 
     printf("Frame %d -> Page %d (Ref=%d)\n",
            frame_victim,
-           page_victim,
+           page_number(S, page_victim),
            S->pgt[page_victim].referenced);
 }
@@ -0,0 +1,476 @@
+/*
+    sim_pag_fifo_sweep.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+// Simulates FIFO replacement with many numbers of frames at once.
+// FIFO is not a stack algorithm (more frames may give more page
+// faults: Belady's anomaly), so each number of frames needs its
+// own simulation; but the trace is read only once and all the
+// instances advance together, one reference at a time.
+//
+// The state of the instances is kept as a structure of arrays:
+// resident[page*K+k] says if the page is in memory in instance k,
+// so the hit check of a reference is a single pass over K
+// consecutive bytes, which the compiler vectorizes.
+//
+// That makes the memory grow with pages*K and the time of each
+// reference with K, so without --step the numbers of frames are
+// spread over at most DEFAULT_SIZES instances, and grids with
+// more than MAX_GRID page-instance pairs are refused.
+
+#define DEFAULT_SIZES 256
+#define MAX_GRID (1<<28)
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagsz;
+    const char * algorithms, * initialstates, * sizes;  // Lists
+
+    // Options (--name=value) that may follow the parameters
+    int minframes, maxframes;   // Numbers of frames simulated
+    int step;                   // ...in steps of (0 = automatic)
+    const char * tracefile;     // Trace saved by gen_trace
+    int table;                  // 1 = show the faults of every size
+}
+sparameters;
+
+// Structure that holds the state of K FIFO instances
+
+typedef struct
+{
+    int K;                    // Number of instances
+    int numpages;
+    int * frames;             // Frames of each instance
+    unsigned char * resident; // resident[page*K+k]
+    int * queue;              // Pages in memory, in load order
+    int * base;               // First element of each queue
+    int * used;               // Frames already occupied
+    int * hand;               // Oldest page (when full)
+    unsigned * faults;        // Page faults of each instance
+}
+sfifoset;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+int create_fifos (sfifoset *, int numpages, int minframes,
+                  int maxframes, int step);
+void reference_fifos (sfifoset *, int page);
+void free_fifos (sfifoset *);
+
+int sweep (const sparameters *, const char * algorithm,
+           const char * initialstate, int numelem);
+
+// Next item of a list separated by commas (NULL at the end)
+
+static const char * next_item (const char * list)
+{
+    list = strchr (list, ',');
+
+    return list ? list+1 : NULL;
+}
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    char alg[4], ini[4];
+    const char * a, * i, * n;
+    int numelem, ok = 1;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %i %s %s %s\n", argv[0], P.pagsz,
+            P.algorithms, P.initialstates, P.sizes);
+
+    // Every combination of the three lists
+    for (a=P.algorithms; ok && a; a=next_item(a))
+        for (i=P.initialstates; ok && i; i=next_item(i))
+            for (n=P.sizes; ok && n; n=next_item(n))
+            {
+                sscanf (n, "%d", &numelem);
+                strncpy (alg, a, 3);
+                strncpy (ini, i, 3);
+                alg[3] = ini[3] = '\0';
+
+                ok = sweep (&P, alg, ini, numelem) == 0;
+            }
+
+    return ok ? 0 : -1;
+}
+
+// Function that simulates one trace with all the numbers of
+// frames and reports the anomalies. Returns 0 if OK
+
+int sweep (const sparameters * P, const char * algorithm,
+           const char * initialstate, int numelem)
+{
+    strace T;           // Trace (from gen_trace or from a file)
+    sfifoset F;         // FIFO instances
+    int ok, created, r, k, numpags, minframes, maxframes, step;
+    int anomalies;
+    char op;
+    unsigned u;
+
+    if (trace_open(&T,P->tracefile,algorithm,initialstate,numelem)<0)
+        return -1;
+
+    numpags = (T.totelem+P->pagsz-1) / P->pagsz;
+    maxframes = P->maxframes && P->maxframes<numpags ?
+                P->maxframes : numpags;
+    minframes = P->minframes<maxframes ? P->minframes : maxframes;
+    step = P->step ? P->step : (maxframes-minframes)/DEFAULT_SIZES + 1;
+
+    if ((double) numpags * ((maxframes-minframes)/step + 1) > MAX_GRID)
+    {
+        fprintf (stderr, "ERROR: %d pages with %d numbers of frames "
+                         "is too much; use --frames or --step\n",
+                 numpags, (maxframes-minframes)/step + 1);
+        trace_close (&T);
+        return -1;
+    }
+
+    ok = created =
+        create_fifos (&F, numpags, minframes, maxframes, step) == 0;
+
+    while (ok)
+    {
+        r = trace_next (&T, &op, &u);
+
+        if (r<=0)
+        {
+            ok = r==0;
+            break;
+        }
+
+        if (u/P->pagsz < numpags)
+            reference_fifos (&F, u/P->pagsz);
+    }
+
+    if (ok)
+    {
+        printf ("\n%s %s %d: %llu references, %d pages\n",
+                algorithm, initialstate, numelem, T.numrefs, numpags);
+
+        if (P->table)
+            printf ("%8s %10s\n", "FRAMES", "FAULTS");
+
+        for (anomalies=k=0; k<F.K; k++)
+        {
+            if (P->table)
+                printf ("%8d %10u%s\n", F.frames[k], F.faults[k],
+                        k && F.faults[k]>F.faults[k-1] ?
+                        "   <-- Belady's anomaly" : "");
+            else if (k && F.faults[k]>F.faults[k-1])
+                printf ("    Belady's anomaly: %d frames -> %u faults, "
+                        "%d frames -> %u faults (+%u)\n",
+                        F.frames[k-1], F.faults[k-1],
+                        F.frames[k], F.faults[k],
+                        F.faults[k]-F.faults[k-1]);
+
+            anomalies += k && F.faults[k]>F.faults[k-1];
+        }
+
+        printf ("    %d to %d frames: %u to %u faults, %d "
+                "anomal%s\n", F.frames[0], F.frames[F.K-1],
+                F.faults[0], F.faults[F.K-1], anomalies,
+                anomalies==1 ? "y" : "ies");
+    }
+
+    // Also when the trace couldn't be read to the end
+    if (created)
+        free_fifos (&F);
+
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    return ok ? 0 : -1;
+}
+
+// Functions that manipulate the FIFO instances
+
+int create_fifos (sfifoset * F, int numpages, int minframes,
+                  int maxframes, int step)
+{
+    int k, total;
+
+    F->numpages = numpages;
+    F->K = (maxframes-minframes)/step + 1;
+
+    F->frames = (int*) malloc (F->K*sizeof(int));
+    F->base = (int*) malloc (F->K*sizeof(int));
+    F->used = (int*) calloc (F->K, sizeof(int));
+    F->hand = (int*) calloc (F->K, sizeof(int));
+    F->faults = (unsigned*) calloc (F->K, sizeof(unsigned));
+    F->resident = (unsigned char*) calloc ((size_t) numpages*F->K, 1);
+    F->queue = NULL;
+
+    if (F->frames && F->base)
+    {
+        for (total=k=0; k<F->K; k++)
+        {
+            F->frames[k] = minframes + k*step;
+            F->base[k] = total;
+            total += F->frames[k];
+        }
+
+        F->queue = (int*) malloc (total*sizeof(int));
+    }
+
+    if (!F->frames || !F->base || !F->used || !F->hand ||
+        !F->faults || !F->resident || !F->queue)
+    {
+        free_fifos (F);
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+void reference_fifos (sfifoset * F, int page)
+{
+    unsigned char * row = F->resident + (size_t) page*F->K;
+    int * q;
+    int k, victim, nmiss = 0;
+
+    // Hit check in every instance at once
+    for (k=0; k<F->K; k++)
+        nmiss += !row[k];
+
+    if (!nmiss)
+        return;
+
+    for (k=0; k<F->K; k++)
+        if (!row[k])
+        {
+            F->faults[k] ++;
+            q = F->queue + F->base[k];
+
+            if (F->used[k] < F->frames[k])
+                q[F->used[k]++] = page;     // Free frame
+            else
+            {
+                // Replace the oldest page
+                victim = q[F->hand[k]];
+                F->resident[(size_t) victim*F->K + k] = 0;
+                q[F->hand[k]] = page;
+
+                if (++F->hand[k] == F->frames[k])
+                    F->hand[k] = 0;
+            }
+
+            row[k] = 1;
+        }
+}
+
+void free_fifos (sfifoset * F)
+{
+    free (F->frames);
+    free (F->base);
+    free (F->used);
+    free (F->hand);
+    free (F->faults);
+    free (F->resident);
+    free (F->queue);
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
+#define VALID_INIT_ORD "ASC/DES/RAN"
+
+// Checks a list of names separated by commas
+
+static int valid_list (const char * list, const char * valid)
+{
+    const char * p;
+    char name[4];
+
+    for (p=list; ; p+=4)
+    {
+        if (strlen(p)<3 || (p[3]!=',' && p[3]!='\0'))
+            return 0;
+
+        strncpy (name, p, 3);
+        name[3] = '\0';
+
+        if (strchr(name,'/') || !strstr(valid,name))
+            return 0;
+
+        if (p[3]=='\0')
+            return 1;
+    }
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i, n, size;
+    const char * s;
+
+    // Default parameters
+    p->pagsz = 16;
+    p->algorithms = "MER";
+    p->initialstates = "RAN";
+    p->sizes = "1000";
+    p->minframes = 1;
+    p->maxframes = 0;
+    p->step = 0;
+    p->tracefile = NULL;
+    p->table = 0;
+
+    // Take the options out of argv, so that the remaining
+    // parameters keep their positions
+    for (i=n=1, ok=1; i<argc; i++)
+        if (!strncmp(argv[i],"--",2))
+        {
+            if (parse_option(argv[i],p)<0)
+                ok = 0;
+        }
+        else
+            argv[n++] = argv[i];
+
+    argc = n;
+
+    if (argc>5)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
+                       p->pagsz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->algorithms = argv[2];
+
+        if (!valid_list(p->algorithms,VALID_ALGORITHMS))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->initialstates = argv[3];
+
+        if (!valid_list(p->initialstates,VALID_INIT_ORD))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial state");
+            ok = 0;
+        }
+
+        if (argc>4)
+            p->sizes = argv[4];
+
+        for (s=p->sizes; ; s+=strcspn(s,",")+1)
+        {
+            if (sscanf(s,"%d",&size)!=1 || size<2)
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong number of "
+                                      "elements");
+                ok = 0;
+                break;
+            }
+
+            if (!s[strcspn(s,",")])
+                break;
+        }
+    }
+
+    if (p->tracefile && (strchr(p->algorithms,',') ||
+                         strchr(p->initialstates,',') ||
+                         strchr(p->sizes,',')))
+    {
+        fprintf (stderr,
+                 "\n    ERROR: --trace only takes one trace");
+        ok = 0;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s pagesize algorithms initialOrders numelems\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tpagesize: # of elements that fit in a page\n"
+             "\talgs: sorting algorithms (%s),\n"
+             "\t      separated by commas\n"
+             "\tinitords: initial states of the array (%s)\n"
+             "\tnumelems: # of elements to be sorted\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--frames=MIN-MAX: numbers of frames simulated\n"
+             "\t        (default 1 to the number of pages)\n"
+             "\t--step=N: ...in steps of N (by default, the\n"
+             "\t        smallest step that gives at most %d)\n"
+             "\t--table: show the page faults of every number\n"
+             "\t        of frames, not only the anomalies\n"
+             "\t--trace=FILE: read the trace from a file saved\n"
+             "\t        with gen_trace instead of running it\n"
+             "\n", DEFAULT_SIZES);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 16 MER RAN 1000\n"
+             "\t%s 1 HEA,QUI ASC,DES,RAN 10,100 --frames=1-20\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok;
+
+    if (!strncmp(arg,"--frames=",9))
+        ok = sscanf(arg+9,"%d-%d",&p->minframes,&p->maxframes)==2 &&
+             p->minframes>0 && p->maxframes>=p->minframes;
+    else if (!strncmp(arg,"--step=",7))
+        ok = sscanf(arg+7,"%d",&p->step)==1 && p->step>0;
+    else if (!strcmp(arg,"--table"))
+        ok = p->table = 1;
+    else if (!strncmp(arg,"--trace=",8))
+        ok = *(p->tracefile = arg+8) != 0;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
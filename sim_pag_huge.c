@@ -0,0 +1,232 @@
+/*
+    sim_pag_huge.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_paging.h"
+
+// The policies keep on managing base pages and frames; a huge
+// page only changes how a region is mapped. When the promoter
+// finds an aligned region with all its pages present, it copies
+// them to a contiguous huge frame (collapse) and from then on a
+// single TLB entry maps the whole region. When the policy evicts
+// one of those pages, the region goes back to base pages (split).
+//
+// The pages of a huge page that are not referenced again while
+// it lasts are its internal fragmentation: with base pages the
+// policy could have given their frames to other pages
+
+// Function that reserves the tables of the huge pages. Returns 0
+// if OK
+
+int huge_init (ssystem * S)
+{
+    shuge * H = &S->huge;
+    int i;
+
+    H->numregions = S->numpags / H->factor;
+    H->promoted = (char*) calloc (H->numregions+1, 1);
+    H->touched = (char*) calloc (S->numpags+1, 1);
+    H->countdown = H->period;
+
+    for (i=0; i<HUGE_TLB_MAX; i++)
+        H->tlb[0][i] = H->tlb[1][i] = -1;
+
+    if (H->promoted && H->touched)
+        return 0;
+
+    fprintf (stderr, "ERROR: not enough dynamic memory\n");
+    return -1;
+}
+
+void huge_free (ssystem * S)
+{
+    free (S->huge.promoted);
+    free (S->huge.touched);
+    S->huge.promoted = S->huge.touched = NULL;
+}
+
+// Number of base pages mapped by a TLB entry
+
+static int entry_pages (shuge * H, int key)
+{
+    return key & 1 ? H->factor : 1;
+}
+
+// Looks a key up in TLB t (fully associative, LRU) and loads it
+// on a miss
+
+static void tlb_lookup (shuge * H, int t, int key)
+{
+    int i, victim = 0;
+
+    for (i=0; i<H->tlbsize; i++)
+    {
+        if (H->tlb[t][i]==key)
+        {
+            H->tlbused[t][i] = H->numrefs;
+            return;
+        }
+
+        // An empty entry or else the least recently used one
+        if (H->tlb[t][victim]!=-1 && (H->tlb[t][i]==-1 ||
+            H->tlbused[t][i] < H->tlbused[t][victim]))
+            victim = i;
+    }
+
+    H->tlbmisses[t] ++;
+
+    if (H->tlb[t][victim]!=-1)
+        H->tlbreach[t] -= entry_pages (H, H->tlb[t][victim]);
+
+    H->tlb[t][victim] = key;
+    H->tlbused[t][victim] = H->numrefs;
+    H->tlbreach[t] += entry_pages (H, key);
+}
+
+// Removes from the TLB with huge pages the entries of region r:
+// the huge one (if huge) or those of its base pages (shootdown)
+
+static void tlb_invalidate (shuge * H, int r, int huge)
+{
+    int i, key;
+
+    for (i=0; i<H->tlbsize; i++)
+    {
+        key = H->tlb[1][i];
+
+        if (key==-1 || (key&1)!=huge ||
+            (huge ? key>>1 : (key>>1)/H->factor) != r)
+            continue;
+
+        H->tlbreach[1] -= entry_pages (H, key);
+        H->tlb[1][i] = -1;
+        H->tlbused[1][i] = 0;
+    }
+}
+
+// Collapses region r into a huge page, if all its pages are
+// present
+
+static void try_to_promote (ssystem * S, int r)
+{
+    shuge * H = &S->huge;
+    int first = r*H->factor, p;
+
+    for (p=first; p<first+H->factor; p++)
+        if (!S->pgt[p].present)
+            return;
+
+    if (S->detailed)
+        sim_event (S, EV_PROMOTE, 0, first, H->factor, 0);
+
+    memset (H->touched+first, 0, H->factor);
+    H->promoted[r] = 1;
+    H->cold += H->factor;
+    H->numpromoted ++;
+
+    if (++H->numhuge > H->maxhuge)
+        H->maxhuge = H->numhuge;
+
+    tlb_invalidate (H, r, 0);
+}
+
+// Function called after every reference to a page (within the
+// address space): it goes through both TLBs and, every 'period'
+// references, wakes up the promoter
+
+void huge_reference (ssystem * S, int page)
+{
+    shuge * H = &S->huge;
+    int r = page / H->factor, i;
+
+    H->numrefs ++;
+
+    if (H->promoted[r])
+    {
+        if (!H->touched[page])
+        {
+            H->touched[page] = 1;
+            H->cold --;
+        }
+
+        tlb_lookup (H, 1, 2*r+1);
+    }
+    else
+        tlb_lookup (H, 1, 2*page);
+
+    tlb_lookup (H, 0, 2*page);
+
+    H->reachsum[0] += H->tlbreach[0];
+    H->reachsum[1] += H->tlbreach[1];
+    H->coldsum += H->cold;
+
+    if (--H->countdown)
+        return;
+
+    H->countdown = H->period;
+
+    for (i=0; i<H->scan && i<H->numregions; i++)
+    {
+        if (!H->promoted[H->hand])
+            try_to_promote (S, H->hand);
+
+        H->hand = (H->hand+1) % H->numregions;
+    }
+}
+
+// Function called by the policies before a page leaves its
+// frame: if it belongs to a huge page, the huge page is split
+
+void huge_evicted (ssystem * S, int page)
+{
+    shuge * H = &S->huge;
+    int r, p;
+
+    if (!H->factor)
+        return;
+
+    r = page / H->factor;
+
+    if (r>=H->numregions || !H->promoted[r])
+        return;
+
+    if (S->detailed)
+        sim_event (S, EV_SPLIT, 0, r*H->factor, page, 0);
+
+    for (p=r*H->factor; p<(r+1)*H->factor; p++)
+        H->cold -= !H->touched[p];
+
+    H->promoted[r] = 0;
+    H->numhuge --;
+    H->numsplit ++;
+
+    tlb_invalidate (H, r, 1);
+}
+
+// Function that shows the results of the huge pages
+
+void print_huge_report (ssystem * S)
+{
+    shuge * H = &S->huge;
+    double refs = H->numrefs ? H->numrefs : 1;
+
+    printf ("Huge pages of %d base pages, TLB of %d entries\n",
+            H->factor, H->tlbsize);
+    printf ("Promotions (collapses):   %d (%d pages copied)\n",
+            H->numpromoted, H->numpromoted*H->factor);
+    printf ("Splits (on evictions):    %d\n", H->numsplit);
+    printf ("Huge pages at the end:    %d (peak %d)\n",
+            H->numhuge, H->maxhuge);
+    printf ("TLB misses, base pages:   %llu (%.2f%%)\n",
+            H->tlbmisses[0], 100*H->tlbmisses[0]/refs);
+    printf ("TLB misses, huge pages:   %llu (%.2f%%)\n",
+            H->tlbmisses[1], 100*H->tlbmisses[1]/refs);
+    printf ("Average TLB reach:        %.1f pages (%.1f with base "
+            "pages)\n", H->reachsum[1]/refs, H->reachsum[0]/refs);
+    printf ("Internal fragmentation:   %.1f pages on average "
+            "(%d at the end)\n", H->coldsum/refs, H->cold);
+}
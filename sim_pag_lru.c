@@ -10,6 +10,9 @@
 
 #include "./sim_paging.h"
 
+static int load_page(ssystem* S, int page, const int keep[], int nkeep);
+static int next_victim(ssystem* S);
+
 // Function that initialises the tables
 
 void init_tables(ssystem* S) {
@@ -61,12 +64,14 @@ unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
     frame = S->pgt[page].frame;
     physical_addr = frame * S->pagsz + offset;
 
+    if (S->pgt[page].prefetched)
+        prefetch_used(S, page);
+
     // Simular la referencia (contadores, modified, etc.)
     reference_page(S, page, op);
 
     if (S->detailed) {
-        printf("\t%c %u == P%d(F%d) + %d\n",
-               op, virtual_addr, page, frame, offset);
+        sim_event(S, EV_ACCESS, op, virtual_addr, frame, 0);
     }
 
     return physical_addr;
@@ -77,15 +82,14 @@ void reference_page(ssystem* S, int page, char op) {
     S->numrefsread++;           // count it
   } else if (op == 'W') {       // If it's a write,
     S->pgt[page].modified = 1;  // count it and mark the
-    S->numrefswrite++;          // page 'modified'+
-
-    S->pgt[page].clock = S->clock;
-    S->clock++;
+    S->numrefswrite++;          // page 'modified'
+  }
 
-    if (S->clock == 0) {   // overflow natural del unsigned
-        if (S->detailed) printf("@ WARNING: clock overflow! Normalizing timestamps...\n");
-    }
+  S->pgt[page].timestamp = S->clock;  // Virtual time of the
+  S->clock++;                         // last reference
 
+  if (S->clock == 0) {   // overflow natural del unsigned
+      if (S->detailed) sim_event(S, EV_CLOCK, 'N', 0, 0, 0);
   }
 }
 
@@ -95,14 +99,36 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
   // TODO(student):
   //       Type in the code that simulates the Operating
   //
-    int page, victim, frame, last;
+    int page, i, n;
+    int batch[PREFETCH_MAX_DEPTH + 1];
 
     S->numpagefaults ++;
     page = virtual_address / S-> pagsz;
     if (S->detailed) {
-        printf ("@ PAGE_FAULT in P %d!\n", page);
+        sim_event (S, EV_FAULT, 0, page, 0, 0);
     }
 
+    pageout_daemon(S);
+
+    load_page(S, page, NULL, 0);
+
+    // Load ahead the next pages of the stream, if any, but
+    // never at the expense of the page that caused the fault
+    // or of the pages loaded ahead before them
+    batch[0] = page;
+    n = prefetch_candidates(S, page, batch + 1);
+
+    for (i = 1; i <= n && load_page(S, batch[i], batch, i) == 0; i++)
+        prefetch_loaded(S, batch[i]);
+}
+
+// Loads the page in a free frame or, if there are none, in the
+// frame of a victim. Fails, before the policy changes anything,
+// if the victim would be one of the nkeep pages of keep[]
+
+static int load_page(ssystem* S, int page, const int keep[], int nkeep) {
+    int victim, frame, last, k;
+
     if (S->listfree != -1) {
 	// There are free frames
         last = S->listfree;
@@ -119,9 +145,18 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
         occupy_free_frame(S, frame, page);
     }else {
 	// There are not free frames
+        if (nkeep) {
+            victim = next_victim(S);
+            for (k = 0; k < nkeep; k++)
+                if (victim == keep[k]) return -1;
+        }
+        PROFILE_START(S, policymark);
         victim = choose_page_to_be_replaced(S);
+        PROFILE_STOP(S, policymark, PROF_CHOOSE);
         replace_page(S, victim, page);
     }
+
+    return 0;
 }
 
 
@@ -144,52 +179,74 @@ int choose_page_to_be_replaced(ssystem* S) {
     }
   }
 
-  if (S->detailed) printf("@ LRU chooses P%d in F%d (ts=%d)\n", victim, frame, lowestTimestamp);
+  if (S->detailed) sim_event(S, EV_CHOOSE, 'L', victim, frame, lowestTimestamp);
 
   return victim;
 }
 
+// Page that choose_page_to_be_replaced would return, without
+// changing anything
+
+static int next_victim(ssystem* S) {
+  int frame, f;
+
+  for (frame = 0, f = 1; f < S->numframes; f++)
+    if (S->pgt[S->frt[f].page].timestamp <
+        S->pgt[S->frt[frame].page].timestamp)
+      frame = f;
+
+  return S->frt[frame].page;
+}
+
 void replace_page(ssystem* S, int victim, int newpage) {
   int frame;
 
   frame = S->pgt[victim].frame;
 
+  if (S->pgt[victim].prefetched) prefetch_evicted(S, victim);
+
   if (S->pgt[victim].modified) {
     if (S->detailed)
-      printf(
-          "@ Writing modified P%d back (to disc) to "
-          "replace it\n",
-          victim);
+      sim_event(S, EV_WRITEBACK, 0, victim, 0, 0);
 
+    swap_write(S, victim);
     S->numpgwriteback++;
   }
 
   if (S->detailed)
-    printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
+    sim_event(S, EV_REPLACE, 0, victim, newpage, frame);
+
+  huge_evicted(S, victim);
 
   S->pgt[victim].present = 0;
 
   S->pgt[newpage].present = 1;
   S->pgt[newpage].frame = frame;
   S->pgt[newpage].modified = 0;
+  S->pgt[newpage].timestamp = S->clock;  // Loaded now (ahead?)
 
   S->frt[frame].page = newpage;
+
+  swap_read(S, newpage);
 }
 
 void occupy_free_frame(ssystem* S, int frame, int page) {
 
     if (S->detailed)
-        printf("@ Storing P%d in F%d\n", page, frame);
+        sim_event(S, EV_STORE, 0, page, frame, 0);
 
     // 1. Actualizar la tabla de pginas
     S->pgt[page].frame     = frame;
     S->pgt[page].present   = 1;
     S->pgt[page].modified  = 0;    // al cargarse no est modificada
     S->pgt[page].referenced = 0;   // aun no se ha referenciado, solo se ha cargado. En otro momento se referenciar
+    S->pgt[page].timestamp = S->clock;  // Loaded now (ahead?)
 
     // 2. Actualizar la tabla de frames
     S->frt[frame].page = page;
 
+    swap_read(S, page);
+
     // RANDOM REPLACEMENT:
     // No se usa listoccupied, no se toca la lista
 
@@ -253,5 +310,6 @@ void print_replacement_report(ssystem* S) {
   printf("LRU replacement\n"
          "lowest timestamp = %u in frame %d  (page %d)\n"
          "highest timestamp = %u  in frame %d  (page %d)\n",
-         lowt, lowf, lowp, hight, highf,highp);
+         lowt, lowf, page_number(S, lowp), hight, highf,
+         page_number(S, highp));
 }
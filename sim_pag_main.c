@@ -5,8 +5,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
 
 #include "sim_paging.h"
+#include "trace.h"
+#include "sample.h"
+#include "sketch.h"
+#include "perf_counters.h"
 
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
@@ -17,27 +24,94 @@ typedef struct
     const char * algorithm, * initialstate;
     int numelem;
     char detailed;
+
+    // Options (--name=value) that may follow the parameters
+    unsigned tau;       // WS window / PFF threshold (in refs.)
+    sswap swap;         // Parameters of the swap device
+    int prefetch;       // Pages loaded ahead (0 = none)
+    shuge huge;         // Huge pages and TLB (factor 0 = none)
+    const char * tracefile;     // Trace saved by gen_trace
+    const char * savefile;      // Checkpoint to be written...
+    unsigned long long saveat;  // ...after these references
+    const char * loadfile;      // Checkpoint to start from
+    const char * eventfile;     // Binary log of the detailed mode
+    unsigned long long detailfrom, detailto;  // Window of refs.
+    sevfilter evfilter;         // Events shown in detailed mode
+    double samplerate;          // Fixed fraction of pages simulated
+    int samplesize;             // ...or fixed number of pages
+    char tables;                // Print the page and frame tables
+    int topn;                   // Pages in the top-N lists
+    const char * reportfile;    // Report as JSON or CSV...
+    char reportformat;          // ...('j' or 'c')
+    const char * seriesfile;    // Time series...
+    unsigned interval;          // ...with a line every N refs.
+    char profile;               // Show the time of each phase
+    char perf;                  // Read the hardware counters
 }
 sparameters;
 
+// Function that stores in *pages the sampled pages, in order,
+// and in M the number of each one in the sample. It takes a pass
+// over the address space, but memory only for the sample.
+// Returns the number of pages (-1 if there is no memory)
+
+int number_sampled_pages (const ssample * A, unsigned numpags,
+                          int ** pages, skeymap * M)
+{
+    unsigned p;
+    int n = 0;
+
+    for (p=0; p<numpags; p++)
+        n += sample_wanted (A, p);
+
+    *pages = (int*) malloc ((n+1)*sizeof(int));
+
+    if (!*pages || keymap_init(M,n)<0)
+        return -1;
+
+    for (p=0, n=0; p<numpags; p++)
+        if (sample_wanted(A,p))
+        {
+            (*pages)[n] = p;
+            keymap_put (M, p, n++);
+        }
+
+    return n;
+}
+
 // Function that parses the parameters received through the
 // command line:
 
 int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+// Function that numbers the pages of the sample in order, so
+// that the tables only need room for them:
+
+int number_sampled_pages (const ssample*, unsigned, int**, skeymap*);
 
 // Main function
 
 int main (int argc, char * argv[])
 {
     sparameters P;      // Parameters received in the command line
-    char command[100];  // Command for executing gen_trace
-    FILE * pipe;        // Communication channel with gen_trace
-    int ok;             // Flag
+    strace T;           // Trace (from gen_trace or from a file)
+    sckptpos pos;       // Position of a checkpoint in the trace
+    int ok, r;          // Flags
     char op;            // Elementary operation ('R'ead, 'W'ri..)
     unsigned u;         // Number of the read/written element
     unsigned numpags;   // Total number of pages
-    unsigned totelem;   // Total num. of elements (double in MER)
     ssystem S;          // State of the whole simulated system
+    ssample A;          // Pages simulated (if sampling)
+    skeymap M;          // Page -> number in the sample
+    int slot;           // Number in the sample of the page
+    sperfcounters C;    // Hardware counters (if P.perf)
+    unsigned long long firstref;    // First reference simulated
+    int before;         // Page faults before the reference
+    unsigned page;      // Page of the reference
+#ifdef SIM_PROFILE
+    struct timespec start, end;     // To calibrate the ticks
+#endif
 
     memset (&S, 0, sizeof(S));  // Reset system
 
@@ -49,84 +123,282 @@ int main (int argc, char * argv[])
             P.algorithm, P.initialstate, P.numelem,
             P.detailed?'D':'N');
 
-    // Prepare command for invoking gen_trace
-    // (sprintf "prints" in a string)
-    sprintf (command, "./gen_trace %s %s %u",
-                      P.algorithm, P.initialstate, P.numelem);
+    // Open the trace and read the total # of elements
+    // to be sorted (double in MER)
+    if (trace_open(&T,P.tracefile,P.algorithm,
+                   P.initialstate,P.numelem)<0)
+        return -1;
+
+    printf ("# Executing command:  %s\n", T.command);
 
-    printf ("# Executing command:  %s\n", command);
+    // Calculate total number of pages
+    numpags = (T.totelem+P.pagsz-1) / P.pagsz;
 
-    // Invoke gen_trace and open a pipe to read
-    // its standard output ("r" stands for read)
-    pipe = popen (command, "r");
+    // With a fixed sample size, the rate follows from the size
+    // of the address space
+    if (P.samplesize)
+        P.samplerate = P.samplesize<numpags ?
+                       (double) P.samplesize/numpags : 1;
 
-    if (!pipe)
+    if (P.samplerate)
     {
-        perror ("ERROR while starting gen_trace");
-        return -1;
-    }
+        sample_init_rate (&A, P.samplerate);
+        S.samplerate = sample_rate (&A);
 
-    // Read total # of elements to be sorted
-    ok = fscanf (pipe," T %u", &totelem) == 1;
+        // Physical memory shrinks in the same proportion, and so
+        // does the time (in references) of WS and PFF
+        P.numframes = P.numframes*S.samplerate + 0.5;
+        P.tau = P.tau*S.samplerate + 0.5;
 
-    if (ok)
-    {
-        // Calculate total number of pages
-        numpags = (totelem+P.pagsz-1) / P.pagsz;
+        if (P.numframes<1)
+            P.numframes = 1;
 
-        S.pgt = (spage*) malloc (numpags*sizeof(spage));
-        S.frt = (sframe*) malloc (P.numframes*sizeof(sframe));
+        if (P.tau<1)
+            P.tau = 1;
 
-        if (!S.pgt || !S.frt)
+        // Only the sampled pages get an entry in the tables
+        S.totalpags = numpags;
+        r = number_sampled_pages (&A, numpags, &S.sampledpage, &M);
+
+        if (r<=0)
         {
-            fprintf (stderr,
-                     "ERROR: not enough dynamic memory\n");
-            ok = 0;
+            fprintf (stderr, r<0 ? "ERROR: not enough dynamic memory\n"
+                                 : "ERROR: no page in the sample\n");
+            return -1;
         }
+
+        S.numpags = r;
     }
+    else
+        S.numpags = numpags;
 
-    if (ok)
+    S.pgt = (spage*) malloc (S.numpags*sizeof(spage));
+    S.frt = (sframe*) malloc (P.numframes*sizeof(sframe));
+    S.pagerefs = (unsigned*) calloc (S.numpags, sizeof(unsigned));
+    S.pagefaults = (unsigned*) calloc (S.numpags, sizeof(unsigned));
+
+    S.swap = P.swap;
+    S.prefetch.depth = P.prefetch;
+    S.huge = P.huge;
+
+    if (S.swap.enabled)
+        S.swap.slot = (int*) malloc (S.numpags*sizeof(int));
+
+    ok = S.pgt && S.frt && (!S.swap.enabled || S.swap.slot) &&
+         S.pagerefs && S.pagefaults;
+
+    if (!ok)
+        fprintf (stderr,
+                 "ERROR: not enough dynamic memory\n");
+    else
     {
         S.pagsz = P.pagsz;
-        S.numpags = numpags;
         S.numframes = P.numframes;
-        S.detailed = P.detailed;
+        S.evfilter = P.evfilter;
+        S.tau = P.tau;
+        S.showtables = P.tables || P.detailed;
+        S.topn = P.topn;
+
+        if (S.swap.enabled)
+            memset (S.swap.slot, -1, S.numpags*sizeof(int));
 
         init_tables (&S);
+        ok = !S.initerror;
+
+        if (ok && S.huge.factor)
+            ok = huge_init (&S) == 0;
+
+        if (ok && P.eventfile)
+            ok = open_event_log (&S, P.eventfile);
     }
 
-    while (ok)
+    // Start from a checkpoint: restore the state and go on
+    // reading the trace from the same point
+    if (ok && P.loadfile)
     {
-        // Ignore spaces and read one character
-        if (fscanf(pipe," %c",&op)!=1)
+        ok = load_checkpoint (&S, P.loadfile, &pos) == 0;
+
+        if (ok && (pos.totelem!=T.totelem ||
+                   strcmp(pos.algorithm,P.algorithm) ||
+                   strcmp(pos.initialstate,P.initialstate) ||
+                   pos.numelem!=P.numelem))
         {
+            fprintf (stderr, "ERROR: checkpoint %s was taken on "
+                             "another trace\n", P.loadfile);
             ok = 0;
+        }
+
+        if (ok)
+        {
+            printf ("# Restored %s after %llu references\n",
+                    P.loadfile, pos.numrefs);
+            ok = trace_seek (&T, pos.numrefs, pos.offset) == 0;
+        }
+    }
+
+    // The time series starts where the simulation (re)starts
+    if (ok && P.seriesfile)
+        ok = open_series (&S, P.seriesfile, P.interval) == 0;
+
+    // Position of the checkpoint to be saved, if any
+    memset (&pos, 0, sizeof(pos));
+    pos.totelem = T.totelem;
+    strncpy (pos.algorithm, P.algorithm, 3);
+    strncpy (pos.initialstate, P.initialstate, 3);
+    pos.numelem = P.numelem;
+
+    // The detailed mode may be limited to a window of references
+    S.detailed = P.detailed && T.numrefs>=P.detailfrom &&
+                 T.numrefs<P.detailto;
+
+    // After --load, the references before the checkpoint are not
+    // simulated (nor counted by the hardware counters)
+    firstref = T.numrefs;
+
+    if (P.perf)
+    {
+        perf_open (&C);
+        perf_start (&C);
+    }
+
+#ifdef SIM_PROFILE
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    S.prof.totalticks = profile_ticks ();
+#endif
+
+    while (ok)
+    {
+        if (T.numrefs==P.detailfrom || T.numrefs==P.detailto)
+            S.detailed = P.detailed && T.numrefs>=P.detailfrom &&
+                         T.numrefs<P.detailto;
+
+        if (P.savefile && T.numrefs==P.saveat)
+        {
+            pos.numrefs = T.numrefs;
+            pos.offset = trace_tell (&T);
+            ok = save_checkpoint (&S, P.savefile, &pos) == 0;
+            P.savefile = NULL;
+        }
+
+        PROFILE_START (&S, mark);
+        r = trace_next (&T, &op, &u);
+        PROFILE_STOP (&S, mark, PROF_TRACE);
+
+        if (r<=0)        // 'S'orted -> end
+        {                // (or something else -> error)
+            ok = r==0;
             break;
         }
 
-        if (op=='R' || op=='W')              // If R/W,
-        {                                    // take element
-            if (fscanf(pipe,"%u",&u)!=1)     // number and
-                ok = 0;                      // annotate
-            else
-                sim_mmu (&S, u, op);  // Simulate memory access
+        page = u / P.pagsz;
+
+        // Only the references to sampled pages are simulated, as
+        // references to their number in the sample
+        if (S.samplerate && page<numpags)
+        {
+            slot = keymap_get (&M, page);
+
+            if (slot==-1)
+            {
+                S.numskipped ++;
+                continue;
+            }
+
+            u = slot*P.pagsz + u%P.pagsz;
+            page = slot;
+        }
+
+        before = S.numpagefaults;
+        PROFILE_START (&S, mark);
+        sim_mmu (&S, u, op);  // Simulate memory access
+        PROFILE_STOP (&S, mark, S.numpagefaults!=before ?
+                                PROF_FAULT : PROF_HIT);
+
+        if (!--S.series.countdown)
+            series_point (&S);
+
+        if (page<S.numpags)
+        {
+            S.pagerefs[page] ++;
+            S.pagefaults[page] += S.numpagefaults!=before;
+
+            if (S.huge.factor)
+                huge_reference (&S, page);
         }
-        else if (op=='S')        // 'S'orted -> end
-            break;               // 'C'omparison -> go on
-        else if (op!='C')        // 'O'ut of order (or
-            ok = 0;              // something else) -> error
+
+        S.swap.now += S.swap.memlat;
+    }
+
+    // Not reached: save the final state
+    if (ok && P.savefile)
+    {
+        pos.numrefs = T.numrefs;
+        pos.offset = -1;
+        ok = save_checkpoint (&S, P.savefile, &pos) == 0;
+    }
+
+    if (close_series(&S)<0)
+    {
+        fprintf (stderr, "ERROR: can't write %s\n", P.seriesfile);
+        ok = 0;
     }
 
+    // Write the events still in the buffer
+    if (!close_event_log(&S))
+    {
+        fprintf (stderr, "ERROR: can't write %s\n", P.eventfile);
+        ok = 0;
+    }
+
+    if (P.perf)
+        perf_stop (&C);
+
+#ifdef SIM_PROFILE
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    S.prof.totalticks = profile_ticks () - S.prof.totalticks;
+    S.prof.ticksperns = S.prof.totalticks /
+                        ((end.tv_sec-start.tv_sec)*1e9 +
+                         (end.tv_nsec-start.tv_nsec) + 1);
+#endif
+
     if (ok)
+    {
+        PROFILE_START (&S, mark);
         print_report (&S);
+        PROFILE_STOP (&S, mark, PROF_REPORT);
+    }
+
+    if (ok && P.profile)
+        print_profile_report (&S);
+
+    if (ok && P.perf)
+    {
+        printf ("\n-------- HARDWARE COUNTERS --------\n\n");
+
+        perf_print (&C, T.numrefs - firstref);
+    }
+
+    if (ok && P.reportfile)
+        ok = write_report (&S, P.reportfile, P.reportformat) == 0;
 
     // Wait until gen_trace ends and close
-    if (pclose(pipe)==-1)
+    if (trace_close(&T)<0)
         ok = 0;
 
     // Free dynamic memory
     free (S.pgt);
     free (S.frt);
+    free (S.window);
+    free (S.swap.slot);
+    free (S.pagerefs);
+    free (S.pagefaults);
+    huge_free (&S);
+
+    if (S.samplerate)
+    {
+        free (S.sampledpage);
+        keymap_free (&M);
+    }
 
     return ok ? 0 : -1;
 }
@@ -146,21 +418,96 @@ void print_report (ssystem * S)
         printf ("\nWARNING: %d REFERENCES OUT OF RANGE\n",
                 S->numillegalrefs);
 
-    printf ("\n---------- PAGES TABLE ---------\n\n");
+    printf ("\n----------- PAGES REPORT -----------\n\n");
+
+    print_pages_report (S);
 
-    print_page_table (S);
+    // One line per page and per frame: only if asked for
+    if (S->showtables)
+    {
+        printf ("\n---------- PAGES TABLE ---------\n\n");
+
+        print_page_table (S);
 
-    printf ("\n---------- FRAMES TABLE ----------\n\n");
+        printf ("\n---------- FRAMES TABLE ----------\n\n");
 
-    print_frames_table (S);
+        print_frames_table (S);
+    }
 
     printf ("\n--------- REPLACEMENT REPORT ---------\n\n");
 
     print_replacement_report (S);
 
+    if (S->prefetch.depth)
+        print_prefetch_report (S);
+
+    if (S->huge.factor)
+    {
+        printf ("\n--------- HUGE PAGES REPORT ---------\n\n");
+
+        print_huge_report (S);
+    }
+
+    if (S->swap.enabled)
+    {
+        printf ("\n------------ SWAP REPORT ------------\n\n");
+
+        print_swap_report (S);
+    }
+
+    if (S->samplerate)
+    {
+        printf ("\n---------- SAMPLING REPORT ----------\n\n");
+
+        print_sampling_report (S);
+    }
+
     printf ("\n-------------------------------------\n\n");
-    printf ("PAGE FAULTS: --->> %d <<---\n\n",
-            S->numpagefaults);
+
+    if (S->samplerate)
+        printf ("PAGE FAULTS (estimated): --->> %.0f <<---\n\n",
+                S->numpagefaults/S->samplerate);
+    else
+        printf ("PAGE FAULTS: --->> %d <<---\n\n",
+                S->numpagefaults);
+}
+
+// Function that scales the results of a sampled run up to the
+// whole address space. Each page is in the sample with
+// probability R, so every sampled page stands for 1/R pages and
+// the variance of the estimate of the faults (Horvitz-Thompson)
+// is estimated by the sum of (1-R)/R^2 * faults^2 over the
+// sampled pages. This is only the error due to the choice of
+// pages: the scaled-down memory adds some bias of its own
+
+void print_sampling_report (ssystem * S)
+{
+    double R = S->samplerate, var = 0, se;
+    int p, faulted = 0;
+
+    for (p=0; p<S->numpags; p++)
+        if (S->pagefaults[p])
+        {
+            var += (1-R)/(R*R) * S->pagefaults[p] *
+                   (double) S->pagefaults[p];
+            faulted ++;
+        }
+
+    se = sqrt (var);
+
+    printf ("Sampling rate:            %.6f\n", R);
+    printf ("Frames simulated:         %d\n", S->numframes);
+    printf ("Pages simulated:          %d of %d\n",
+            S->numpags, S->totalpags);
+    printf ("Pages with faults:        %d\n", faulted);
+    printf ("References simulated:     %d of %llu\n",
+            S->numrefsread + S->numrefswrite,
+            S->numrefsread + S->numrefswrite + S->numskipped);
+    printf ("Estimated page faults:    %.0f +- %.0f (%.2f%%)\n",
+            S->numpagefaults/R, se,
+            S->numpagefaults ? 100*se*R/S->numpagefaults : 0.0);
+    printf ("Estimated dumps to disc:  %.0f\n",
+            S->numpgwriteback/R);
 }
 
 // Function that parses the parameters received through the
@@ -171,7 +518,7 @@ void print_report (ssystem * S)
 
 int parse_command (int argc, char * argv[], sparameters * p)
 {
-    int ok;
+    int ok, i, n;
 
     // Default parameters
     p->pagsz = 16;
@@ -180,6 +527,52 @@ int parse_command (int argc, char * argv[], sparameters * p)
     p->initialstate = "RAN";
     p->numelem = 1000;
     p->detailed = 0;
+    p->tau = 1000;
+
+    memset (&p->swap, 0, sizeof(p->swap));
+    p->swap.memlat = 100;
+    p->swap.readlat = 100000;
+    p->swap.writelat = 100000;
+    p->swap.bandwidth = 500;
+    p->swap.watermark = 1;
+    p->swap.cluster = 8;
+    p->prefetch = 0;
+    memset (&p->huge, 0, sizeof(p->huge));
+    p->huge.tlbsize = 64;
+    p->huge.period = 1000;
+    p->huge.scan = 8;
+    p->tracefile = p->savefile = p->loadfile = NULL;
+    p->eventfile = NULL;
+    p->samplerate = 0;
+    p->samplesize = 0;
+    p->tables = 0;
+    p->topn = 10;
+    p->reportfile = NULL;
+    p->reportformat = 'j';
+    p->seriesfile = NULL;
+    p->interval = 2000;
+    p->profile = 0;
+    p->perf = 0;
+    p->detailfrom = 0;
+    p->detailto = ~0ULL;
+    p->evfilter.on = 0;
+    p->evfilter.types = ~0U;
+    p->evfilter.firstpage = 0;
+    p->evfilter.lastpage = INT_MAX;
+    p->saveat = ~0ULL;
+
+    // Take the options out of argv, so that the remaining
+    // parameters keep their positions
+    for (i=n=1, ok=1; i<argc; i++)
+        if (!strncmp(argv[i],"--",2))
+        {
+            if (parse_option(argv[i],p)<0)
+                ok = 0;
+        }
+        else
+            argv[n++] = argv[i];
+
+    argc = n;
 
     if (argc>7)
     {
@@ -189,8 +582,6 @@ int parse_command (int argc, char * argv[], sparameters * p)
     }
     else
     {
-        ok = 1;
-
         if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
                        p->pagsz<1))
         {
@@ -249,10 +640,19 @@ int parse_command (int argc, char * argv[], sparameters * p)
                 ok = 0;
             }
 
-            p->detailed = !strcmp(argv[6],"D");
+            p->detailed = !strcmp(argv[6],"D") || p->detailed;
         }
     }
 
+    // The regions of huge pages would be made of pages that are
+    // consecutive in the sample, but not in the address space
+    if (p->huge.factor && (p->samplerate || p->samplesize))
+    {
+        fprintf (stderr,
+                 "\n    ERROR: --huge can't be used with sampling");
+        ok = 0;
+    }
+
     if (ok)
         return 0;
 
@@ -268,12 +668,204 @@ int parse_command (int argc, char * argv[], sparameters * p)
              "\n",
              VALID_ALGORITHMS, VALID_INIT_ORD);
 
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--tau=N: WS window / PFF inter-fault threshold,\n"
+             "\t         in references (default 1000)\n"
+             "\t--swap: simulate the cost of the I/O with the\n"
+             "\t        swap device (implied by the following)\n"
+             "\t--memlat=NS: cost of a memory reference (100)\n"
+             "\t--rdlat=NS, --wrlat=NS: latency of the device\n"
+             "\t        for reads and writes (100000)\n"
+             "\t--bw=MBPS: bandwidth of the device (500)\n"
+             "\t--watermark=N: the pageout daemon cleans pages\n"
+             "\t        when fewer frames than N are free (1)\n"
+             "\t--cluster=N: pages per daemon write (8)\n"
+             "\t--prefetch=N: on page faults that follow a\n"
+             "\t        sequential or strided stream, load the\n"
+             "\t        next N pages of the stream (0, max %d)\n"
+             "\t--huge=N: huge pages of N base pages, promoted\n"
+             "\t        when all their pages are present and\n"
+             "\t        split when one of them is evicted\n"
+             "\t--huge-period=N, --huge-scan=M: the promoter\n"
+             "\t        looks at M regions every N references\n"
+             "\t        (1000 and 8)\n"
+             "\t--tlb=N: entries of the TLB simulated (64)\n"
+             "\t--trace=FILE: read the trace from a file saved\n"
+             "\t        with gen_trace instead of running it\n"
+             "\t--save=FILE: save the state of the system to a\n"
+             "\t        checkpoint file, at the end or...\n"
+             "\t--save-at=N: ...after N references\n"
+             "\t--load=FILE: restore a checkpoint and go on\n"
+             "\t        from that point of the same trace\n"
+             "\t--events=FILE: detailed mode, but the events\n"
+             "\t        go to a binary log (see sim_pag_decode)\n"
+             "\t--detail-from=N, --detail-to=M: detailed mode\n"
+             "\t        only from reference N to M-1\n"
+             "\t--detail-pages=P[-Q]: ...only for pages P to Q\n"
+             "\t--detail-events=LIST: ...only for these events\n"
+             "\t        (access,fault,evict,load,prefetch,policy,\n"
+             "\t        huge)\n"
+             "\t--sample-rate=R: only simulate a fraction R of\n"
+             "\t        the pages, with R*numframes frames, and\n"
+             "\t        scale the results up (0 < R <= 1)\n"
+             "\t--sample-size=N: the same with N pages at most\n"
+             "\t        (neither of them with --huge)\n"
+             "\t--tables: print the whole page and frame tables\n"
+             "\t        (always in detailed mode)\n"
+             "\t--top=N: pages in the lists of hottest and most\n"
+             "\t        faulted pages (10)\n"
+             "\t--json=FILE, --csv=FILE: write the report to a\n"
+             "\t        file as JSON or CSV\n"
+             "\t--series=FILE: write the references, faults,\n"
+             "\t        write-backs, resident and dirty pages of\n"
+             "\t        every interval to a file...\n"
+             "\t--interval=N: ...of N references (2000)\n"
+             "\t--profile: show where the time goes (only if\n"
+             "\t        built with make PROFILE=1)\n"
+             "\t--perf: read the hardware counters (cycles,\n"
+             "\t        instructions, LLC and branch misses)\n"
+             "\t        of the simulation loop\n"
+             "\n",
+             PREFETCH_MAX_DEPTH);
+
     fprintf (stderr,
              "    EXAMPLES:\n"
              "\t%s 16 32 MER RAN 1000\n"
              "\t%s 1 3 HEA DES 4 D\n"
+             "\t%s 16 32 MER RAN 1000 N --tau=500\n"
              "\n",
-             argv[0], argv[0]);
+             argv[0], argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok, n;
+
+    if (!strncmp(arg,"--tau=",6))
+        ok = sscanf(arg+6,"%u",&p->tau)==1 && p->tau>0;
+    else if (!strncmp(arg,"--prefetch=",11))
+        ok = sscanf(arg+11,"%d",&p->prefetch)==1 &&
+             p->prefetch>=0 && p->prefetch<=PREFETCH_MAX_DEPTH;
+    else if (!strncmp(arg,"--huge=",7))
+        ok = sscanf(arg+7,"%d",&p->huge.factor)==1 &&
+             p->huge.factor>1;
+    else if (!strncmp(arg,"--huge-period=",14))
+        ok = sscanf(arg+14,"%u",&p->huge.period)==1 &&
+             p->huge.period>0;
+    else if (!strncmp(arg,"--huge-scan=",12))
+        ok = sscanf(arg+12,"%d",&p->huge.scan)==1 &&
+             p->huge.scan>0;
+    else if (!strncmp(arg,"--tlb=",6))
+        ok = sscanf(arg+6,"%d",&p->huge.tlbsize)==1 &&
+             p->huge.tlbsize>0 && p->huge.tlbsize<=HUGE_TLB_MAX;
+    else if (!strncmp(arg,"--trace=",8))
+        ok = *(p->tracefile = arg+8) != 0;
+    else if (!strncmp(arg,"--save=",7))
+        ok = *(p->savefile = arg+7) != 0;
+    else if (!strncmp(arg,"--save-at=",10))
+        ok = sscanf(arg+10,"%llu",&p->saveat)==1;
+    else if (!strncmp(arg,"--load=",7))
+        ok = *(p->loadfile = arg+7) != 0;
+    else if (!strncmp(arg,"--events=",9))
+        ok = p->detailed = *(p->eventfile = arg+9) != 0;
+    else if (!strncmp(arg,"--detail-from=",14))
+        ok = p->detailed =
+             sscanf(arg+14,"%llu",&p->detailfrom)==1;
+    else if (!strncmp(arg,"--detail-to=",12))
+        ok = p->detailed =
+             sscanf(arg+12,"%llu",&p->detailto)==1;
+    else if (!strncmp(arg,"--detail-pages=",15))
+    {
+        n = sscanf(arg+15,"%d-%d",&p->evfilter.firstpage,
+                   &p->evfilter.lastpage);
+
+        if (n==1)
+            p->evfilter.lastpage = p->evfilter.firstpage;
+
+        ok = p->detailed = p->evfilter.on =
+             n>=1 && p->evfilter.firstpage>=0 &&
+             p->evfilter.lastpage>=p->evfilter.firstpage;
+    }
+    else if (!strncmp(arg,"--detail-events=",16))
+        ok = p->detailed = p->evfilter.on =
+             parse_event_types(arg+16,&p->evfilter.types);
+    else if (!strncmp(arg,"--sample-rate=",14))
+        ok = sscanf(arg+14,"%lf",&p->samplerate)==1 &&
+             p->samplerate>0 && p->samplerate<=1;
+    else if (!strncmp(arg,"--sample-size=",14))
+        ok = sscanf(arg+14,"%d",&p->samplesize)==1 &&
+             p->samplesize>0;
+    else if (!strcmp(arg,"--tables"))
+        ok = p->tables = 1;
+    else if (!strncmp(arg,"--top=",6))
+        ok = sscanf(arg+6,"%d",&p->topn)==1 && p->topn>0;
+    else if (!strncmp(arg,"--json=",7))
+    {
+        p->reportformat = 'j';
+        ok = *(p->reportfile = arg+7) != 0;
+    }
+    else if (!strncmp(arg,"--csv=",6))
+    {
+        p->reportformat = 'c';
+        ok = *(p->reportfile = arg+6) != 0;
+    }
+    else if (!strncmp(arg,"--series=",9))
+        ok = *(p->seriesfile = arg+9) != 0;
+    else if (!strncmp(arg,"--interval=",11))
+        ok = sscanf(arg+11,"%u",&p->interval)==1 && p->interval>=2;
+    else if (!strcmp(arg,"--profile"))
+    {
+#ifdef SIM_PROFILE
+        ok = p->profile = 1;
+#else
+        fprintf (stderr, "\n    ERROR: %s needs a build with the "
+                 "profiler (make clean; make PROFILE=1)", arg);
+        return -1;
+#endif
+    }
+    else if (!strcmp(arg,"--perf"))
+        ok = p->perf = 1;
+    else if (!strcmp(arg,"--swap"))
+        ok = p->swap.enabled = 1;
+    else if (!strncmp(arg,"--memlat=",9))
+        ok = p->swap.enabled =
+             sscanf(arg+9,"%u",&p->swap.memlat)==1;
+    else if (!strncmp(arg,"--rdlat=",8))
+        ok = p->swap.enabled =
+             sscanf(arg+8,"%u",&p->swap.readlat)==1;
+    else if (!strncmp(arg,"--wrlat=",8))
+        ok = p->swap.enabled =
+             sscanf(arg+8,"%u",&p->swap.writelat)==1;
+    else if (!strncmp(arg,"--bw=",5))
+        ok = p->swap.enabled =
+             sscanf(arg+5,"%u",&p->swap.bandwidth)==1 &&
+             p->swap.bandwidth>0;
+    else if (!strncmp(arg,"--watermark=",12))
+        ok = p->swap.enabled =
+             sscanf(arg+12,"%d",&p->swap.watermark)==1 &&
+             p->swap.watermark>=0;
+    else if (!strncmp(arg,"--cluster=",10))
+        ok = p->swap.enabled =
+             sscanf(arg+10,"%d",&p->swap.cluster)==1 &&
+             p->swap.cluster>0;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
 
     return -1;
 }
@@ -0,0 +1,668 @@
+/*
+    sim_pag_mrc.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "trace.h"
+#include "stack_dist.h"
+#include "sample.h"
+
+// Computes the miss ratio curve (MRC) of LRU in a single pass:
+// the page faults of LRU for every number of frames, from the
+// histogram of LRU stack distances. With --sample-rate or
+// --sample-size only a spatially hashed sample of the pages is
+// followed (SHARDS) and the distances are scaled by 1/rate.
+// With --threads, the exact curve is computed in parallel.
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagsz;
+    const char * algorithm, * initialstate;
+    int numelem;
+
+    // Options (--name=value) that may follow the parameters
+    const char * tracefile;     // Trace saved by gen_trace
+    double rate;                // Fixed sampling rate (0 = none)
+    int maxpages;               // Fixed sample size (0 = none)
+    int check;                  // 1 = compare with the exact MRC
+    int step;                   // Frames between rows (0 = auto)
+    int threads;                // Threads for the exact curve
+}
+sparameters;
+
+// Histogram of stack distances: hist[d] for d=1..numpages, and
+// hist[numpages+1] for the first references
+
+typedef struct
+{
+    int numpages;
+    double * hist;
+    double total;         // References (weighted)
+}
+shistogram;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+// Part of the trace whose distances are computed by one thread.
+// Only the distances of the references to pages already seen in
+// the chunk are known there; the first references to the other
+// pages are resolved later against the stack of the previous
+// chunks, and then the pages of the chunk are moved to its top
+// in the order of their last references
+
+#define CHUNK_REFS (1<<20)      // References per chunk
+
+typedef struct
+{
+    const int * pages;          // Pages referenced in the chunk
+    int numrefs;
+    sstackdist D;               // Stack of the chunk
+    unsigned long long * hist;  // hist[d] of the resolved refs.
+    int * first;                // Pages in order of first ref.
+    int numfirst;
+    int * order;                // Pages in order of last ref.
+    int numorder;
+}
+schunk;
+
+int parallel_histogram (strace *, const sparameters *, int numpages,
+                        shistogram *);
+
+int reserve_histogram (shistogram *, int numpages);
+void count_distance (shistogram *, double dist, double weight);
+void misses_per_frames (const shistogram *, double miss[]);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    strace T;           // Trace (from gen_trace or from a file)
+    int ok, r, i, n;    // Flags and counters
+    char op;            // Elementary operation ('R'ead, 'W'ri..)
+    unsigned u, d;      // Element, stack distance
+    int page, numpags;  // Page referenced, total number of pages
+    int sampling;       // 1 = only a sample of the pages
+    ssample A;          // Sample of the pages
+    double rate, weight;        // Current rate and 1/rate
+    unsigned long long numsampled;  // References to sampled pages
+    sstackdist D, E;    // Stacks: sampled and exact (check only)
+    shistogram H, X;    // Histograms: sampled and exact
+    double * miss, * exact;     // Misses per number of frames
+    int * dropped;      // Pages that leave a fixed-size sample
+    double err, maxerr, sumerr;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %i %s %s %i\n",
+            argv[0], P.pagsz,
+            P.algorithm, P.initialstate, P.numelem);
+
+    if (trace_open(&T,P.tracefile,P.algorithm,
+                   P.initialstate,P.numelem)<0)
+        return -1;
+
+    printf ("# Executing command:  %s\n", T.command);
+
+    // Calculate total number of pages
+    numpags = (T.totelem+P.pagsz-1) / P.pagsz;
+
+    sampling = P.rate>0 || P.maxpages>0;
+
+    if (P.maxpages)
+        ok = sample_init_size (&A, P.maxpages) == 0;
+    else
+        ok = sample_init_rate (&A, sampling ? P.rate : 1.0) == 0;
+
+    // The stack only holds the pages of the sample
+    n = P.maxpages ? P.maxpages : (int) (sample_rate(&A)*numpags) + 1;
+
+    ok = ok && stack_dist_init (&D, numpags, n) == 0 &&
+         reserve_histogram (&H, numpags) == 0;
+
+    if (ok && P.check)
+        ok = stack_dist_init (&E, numpags, numpags) == 0 &&
+             reserve_histogram (&X, numpags) == 0;
+
+    dropped = (int*) malloc ((P.maxpages+1)*sizeof(int));
+    miss = (double*) malloc ((numpags+1)*sizeof(double));
+    exact = (double*) malloc ((numpags+1)*sizeof(double));
+
+    if (ok && (!dropped || !miss || !exact))
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        ok = 0;
+    }
+
+    rate = sample_rate (&A);
+    weight = 1/rate;
+    numsampled = 0;
+
+    if (ok && P.threads>1)
+    {
+        // Exact curve in parallel (no sampling)
+        ok = parallel_histogram (&T, &P, numpags, &H) == 0;
+        numsampled = T.numrefs;
+    }
+
+    while (ok && P.threads<=1)
+    {
+        r = trace_next (&T, &op, &u);
+
+        if (r<=0)        // 'S'orted -> end
+        {                // (or something else -> error)
+            ok = r==0;
+            break;
+        }
+
+        page = u / P.pagsz;
+
+        if (page>=numpags)
+            continue;
+
+        if (P.check)
+        {
+            d = stack_dist_ref (&E, page);
+            count_distance (&X, d, 1);
+        }
+
+        if (!sample_wanted(&A,page))
+            continue;
+
+        numsampled ++;
+        d = stack_dist_ref (&D, page);
+
+        if (!d)
+        {
+            // New page in a fixed-size sample: it may push out
+            // the pages with the largest hash (maybe itself)
+            n = sample_add (&A, page, dropped);
+
+            for (i=0; i<n; i++)
+                stack_dist_remove (&D, dropped[i]);
+
+            if (n)
+            {
+                // Later references weigh more, as if the counts
+                // so far had been scaled down to the new rate
+                rate = sample_rate (&A);
+                weight = 1/rate;
+            }
+
+            if (!sample_wanted(&A,page))
+                continue;
+        }
+
+        count_distance (&H, d/rate, weight);
+    }
+
+    if (ok)
+    {
+        // SHARDS adjustment (fixed rate): the difference between
+        // the references expected in the sample and the ones
+        // found goes to the shortest distance
+        if (sampling && !P.maxpages)
+        {
+            H.hist[1] += T.numrefs - H.total;
+
+            if (H.hist[1]<0)
+                H.hist[1] = 0;
+
+            H.total = T.numrefs;
+        }
+
+        misses_per_frames (&H, miss);
+
+        if (P.check)
+            misses_per_frames (&X, exact);
+
+        if (sampling)
+            printf ("# Sampling:  rate %.6f (%s), %llu of %llu "
+                    "references\n", rate,
+                    P.maxpages ? "fixed size" : "fixed rate",
+                    numsampled, T.numrefs);
+
+        if (!P.step)
+            P.step = (numpags+31) / 32;
+
+        printf ("\n%8s %12s %10s", "FRAMES", "FAULTS", "MISS RATIO");
+
+        if (P.check)
+            printf (" %12s %10s", "EXACT", "ERROR");
+
+        printf ("\n");
+
+        for (n=P.step; ; n+=P.step)
+        {
+            if (n>numpags)
+                n = numpags;
+
+            printf ("%8d %12.0f %10.6f", n,
+                    miss[n]*T.numrefs, miss[n]);
+
+            if (P.check)
+                printf (" %12.0f %10.6f",
+                        exact[n]*T.numrefs, miss[n]-exact[n]);
+
+            printf ("\n");
+
+            if (n==numpags)
+                break;
+        }
+
+        // Error of the whole curve (every number of frames)
+        if (P.check)
+        {
+            for (sumerr=maxerr=0, n=1; n<=numpags; n++)
+            {
+                err = fabs (miss[n]-exact[n]);
+                sumerr += err;
+
+                if (err>maxerr)
+                    maxerr = err;
+            }
+
+            printf ("\nMean absolute error:  %.6f\n"
+                    "Max. absolute error:  %.6f\n",
+                    sumerr/numpags, maxerr);
+        }
+    }
+
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    sample_free (&A);
+    stack_dist_free (&D);
+    free (H.hist);
+
+    if (P.check)
+    {
+        stack_dist_free (&E);
+        free (X.hist);
+    }
+
+    free (dropped);
+    free (miss);
+    free (exact);
+
+    return ok ? 0 : -1;
+}
+
+// Thread that computes the distances within a chunk
+
+static void * chunk_thread (void * arg)
+{
+    schunk * C = arg;
+    unsigned d;
+    int i;
+
+    stack_dist_reset (&C->D);
+    memset (C->hist, 0, (C->D.numpages+2)*sizeof(*C->hist));
+    C->numfirst = 0;
+
+    for (i=0; i<C->numrefs; i++)
+        if ((d = stack_dist_ref(&C->D,C->pages[i])) != 0)
+            C->hist[d] ++;
+        else
+            C->first[C->numfirst++] = C->pages[i];
+
+    C->numorder = stack_dist_order (&C->D, C->order);
+
+    return NULL;
+}
+
+// Function that reads the trace in blocks of P->threads chunks,
+// computes the distances within the chunks in parallel and
+// merges them in order: the first reference of a chunk to a page
+// is found in the stack G of the previous chunks, where the pages
+// above it are exactly those referenced in between (in the
+// previous chunks or earlier in this one). Returns 0 if OK
+
+int parallel_histogram (strace * pT, const sparameters * P,
+                        int numpages, shistogram * H)
+{
+    int n = P->threads, ok = 1, r, i, k, numrefs;
+    int * pages;
+    schunk * C;
+    pthread_t * tid;
+    sstackdist G;
+    unsigned long long * hist;
+    char op;
+    unsigned u;
+
+    pages = (int*) malloc ((size_t) n*CHUNK_REFS*sizeof(int));
+    C = (schunk*) calloc (n, sizeof(schunk));
+    tid = (pthread_t*) malloc (n*sizeof(pthread_t));
+    hist = (unsigned long long*) calloc (numpages+2, sizeof(*hist));
+
+    if (!pages || !C || !tid || !hist ||
+        stack_dist_init(&G,numpages,numpages)<0)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        free (pages);
+        free (C);
+        free (tid);
+        free (hist);
+        return -1;
+    }
+
+    for (k=0; k<n && ok; k++)
+    {
+        C[k].hist = (unsigned long long*)
+                    malloc ((numpages+2)*sizeof(*hist));
+        C[k].first = (int*) malloc (numpages*sizeof(int));
+        C[k].order = (int*) malloc (numpages*sizeof(int));
+
+        ok = C[k].hist && C[k].first && C[k].order &&
+             stack_dist_init(&C[k].D,numpages,numpages)==0;
+    }
+
+    if (!ok)
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+
+    for (r=1; ok && r>0; )
+    {
+        // Read the next block
+        for (numrefs=0; numrefs<n*CHUNK_REFS; )
+        {
+            r = trace_next (pT, &op, &u);
+
+            if (r<=0)
+                break;
+
+            if (u/P->pagsz < numpages)
+                pages[numrefs++] = u/P->pagsz;
+        }
+
+        if (r<0)
+        {
+            ok = 0;
+            break;
+        }
+
+        // Share it out among the threads
+        for (k=0; k<n; k++)
+        {
+            C[k].pages = pages + (long) numrefs*k/n;
+            C[k].numrefs = (long) numrefs*(k+1)/n - (long) numrefs*k/n;
+
+            if (pthread_create(&tid[k],NULL,chunk_thread,&C[k]))
+            {
+                fprintf (stderr, "ERROR: can't start a thread\n");
+                exit (-1);
+            }
+        }
+
+        for (k=0; k<n; k++)
+            pthread_join (tid[k], NULL);
+
+        // Merge the chunks in order
+        for (k=0; k<n; k++)
+        {
+            for (i=0; i<=numpages; i++)
+                hist[i] += C[k].hist[i];
+
+            for (i=0; i<C[k].numfirst; i++)
+                hist[stack_dist_ref(&G,C[k].first[i])] ++;
+
+            for (i=0; i<C[k].numorder; i++)
+                stack_dist_ref (&G, C[k].order[i]);
+        }
+    }
+
+    // hist[0] holds the first references
+    if (ok)
+        for (i=0; i<=numpages; i++)
+            if (hist[i])
+                count_distance (H, i, hist[i]);
+
+    for (k=0; k<n; k++)
+    {
+        free (C[k].hist);
+        free (C[k].first);
+        free (C[k].order);
+        stack_dist_free (&C[k].D);
+    }
+
+    stack_dist_free (&G);
+    free (pages);
+    free (C);
+    free (tid);
+    free (hist);
+
+    return ok ? 0 : -1;
+}
+
+// Functions that manipulate the histogram of distances
+
+int reserve_histogram (shistogram * H, int numpages)
+{
+    H->numpages = numpages;
+    H->total = 0;
+    H->hist = (double*) calloc (numpages+2, sizeof(double));
+
+    if (!H->hist)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Counts a reference with the given distance (0 = first one).
+// Scaled distances are rounded and kept within the address space
+
+void count_distance (shistogram * H, double dist, double weight)
+{
+    unsigned d = (unsigned) (dist+0.5);
+
+    if (!dist)
+        d = H->numpages+1;
+    else if (d<1)
+        d = 1;
+    else if (d>H->numpages)
+        d = H->numpages;
+
+    H->hist[d] += weight;
+    H->total += weight;
+}
+
+// miss[c] = ratio of references that are page faults with c
+// frames, i.e. whose distance is greater than c
+
+void misses_per_frames (const shistogram * H, double miss[])
+{
+    double above = 0;
+    int c;
+
+    for (c=H->numpages; c>=0; c--)
+    {
+        above += H->hist[c+1];
+        miss[c] = H->total ? above/H->total : 0;
+    }
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
+#define VALID_INIT_ORD "ASC/DES/RAN"
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i, n;
+
+    // Default parameters
+    p->pagsz = 16;
+    p->algorithm = "MER";
+    p->initialstate = "RAN";
+    p->numelem = 1000;
+    p->tracefile = NULL;
+    p->rate = 0;
+    p->maxpages = 0;
+    p->check = 0;
+    p->step = 0;
+    p->threads = 1;
+
+    // Take the options out of argv, so that the remaining
+    // parameters keep their positions
+    for (i=n=1, ok=1; i<argc; i++)
+        if (!strncmp(argv[i],"--",2))
+        {
+            if (parse_option(argv[i],p)<0)
+                ok = 0;
+        }
+        else
+            argv[n++] = argv[i];
+
+    argc = n;
+
+    if (p->threads>1 && (p->rate>0 || p->maxpages>0 || p->check))
+    {
+        fprintf (stderr,
+                 "\n    ERROR: --threads only computes the exact "
+                 "curve");
+        ok = 0;
+    }
+
+    if (p->rate>0 && p->maxpages>0)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: --sample-rate and --sample-size "
+                 "can't be used together");
+        ok = 0;
+    }
+
+    if (argc>5)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
+                       p->pagsz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->algorithm = argv[2];
+
+        if (strlen(p->algorithm)!=3 ||
+            strchr(p->algorithm,'/') ||
+            !strstr(VALID_ALGORITHMS,p->algorithm))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->initialstate = argv[3];
+
+        if (strlen(p->initialstate)!=3 ||
+            strchr(p->initialstate,'/') ||
+            !strstr(VALID_INIT_ORD,p->initialstate))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial state");
+            ok = 0;
+        }
+
+        if (argc>4 && (sscanf(argv[4],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s pagesize algorithm initialOrder numelem\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tpagesize: # of elements that fit in a page\n"
+             "\talg: sorting algorithm (%s)\n"
+             "\tinitord: initial state of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--trace=FILE: read the trace from a file saved\n"
+             "\t        with gen_trace instead of running it\n"
+             "\t--sample-rate=R: only follow a fraction R of\n"
+             "\t        the pages (0 < R <= 1)\n"
+             "\t--sample-size=N: only follow N pages at most\n"
+             "\t--check: also compute the exact curve and show\n"
+             "\t        the error of the sampled one\n"
+             "\t--step=N: frames between rows (1/32 of pages)\n"
+             "\t--threads=N: compute the exact curve with N\n"
+             "\t        threads, on chunks of the trace\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 16 MER RAN 1000\n"
+             "\t%s 1 QUI RAN 10000 --sample-rate=0.1 --check\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok;
+
+    if (!strncmp(arg,"--trace=",8))
+        ok = *(p->tracefile = arg+8) != 0;
+    else if (!strncmp(arg,"--sample-rate=",14))
+        ok = sscanf(arg+14,"%lf",&p->rate)==1 &&
+             p->rate>0 && p->rate<=1;
+    else if (!strncmp(arg,"--sample-size=",14))
+        ok = sscanf(arg+14,"%d",&p->maxpages)==1 && p->maxpages>0;
+    else if (!strcmp(arg,"--check"))
+        ok = p->check = 1;
+    else if (!strncmp(arg,"--threads=",10))
+        ok = sscanf(arg+10,"%d",&p->threads)==1 &&
+             p->threads>0 && p->threads<=256;
+    else if (!strncmp(arg,"--step=",7))
+        ok = sscanf(arg+7,"%d",&p->step)==1 && p->step>0;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
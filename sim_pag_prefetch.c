@@ -0,0 +1,134 @@
+/*
+    sim_pag_prefetch.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim_paging.h"
+
+// Function called on every page fault (after loading the page).
+// If the fault continues a stream, i.e. it is 'stride' pages
+// away from the last fault of the stream, the next 'depth'
+// pages of the stream that are not present are stored in cand[]
+// so that the OS loads them too. Otherwise, the fault trains
+// the closest stream (or replaces the oldest one). Returns the
+// number of candidates
+
+int prefetch_candidates (ssystem * S, int page, int cand[])
+{
+    sprefetch * F = &S->prefetch;
+    int s, best, oldest, k, n, p;
+
+    if (!F->depth)
+        return 0;
+
+    F->numfaults ++;
+
+    for (s=0; s<PREFETCH_STREAMS; s++)
+        if (F->stride[s] && page-F->last[s]==F->stride[s])
+            break;
+
+    if (s==PREFETCH_STREAMS)
+    {
+        for (best=oldest=0, s=1; s<PREFETCH_STREAMS; s++)
+        {
+            if (abs(page-F->last[s]) < abs(page-F->last[best]))
+                best = s;
+
+            if (F->age[s] < F->age[oldest])
+                oldest = s;
+        }
+
+        if (page!=F->last[best] &&
+            abs(page-F->last[best])<=PREFETCH_MAX_STRIDE)
+            F->stride[best] = page - F->last[best];
+        else
+        {
+            best = oldest;
+            F->stride[best] = 0;
+        }
+
+        F->last[best] = page;
+        F->age[best] = F->numfaults;
+
+        return 0;
+    }
+
+    for (k=n=0, p=page; k<F->depth; k++)
+    {
+        p += F->stride[s];
+
+        if (p<0 || p>=S->numpags)
+        {
+            p -= F->stride[s];
+            break;
+        }
+
+        if (!S->pgt[p].present)
+            cand[n++] = p;
+    }
+
+    if (S->detailed && n)
+        sim_event (S, EV_PREFETCH, 0, n, F->stride[s], 0);
+
+    F->last[s] = p;    // The stream goes on after them
+    F->age[s] = F->numfaults;
+
+    return n;
+}
+
+// Function called after loading a candidate in a frame
+
+void prefetch_loaded (ssystem * S, int page)
+{
+    S->pgt[page].prefetched = 1;
+    S->prefetch.numissued ++;
+}
+
+// Function called when a page loaded ahead is referenced
+// (a page fault avoided)
+
+void prefetch_used (ssystem * S, int page)
+{
+    S->pgt[page].prefetched = 0;
+    S->prefetch.numused ++;
+}
+
+// Function called when a page loaded ahead is evicted without
+// having been referenced
+
+void prefetch_evicted (ssystem * S, int page)
+{
+    if (S->detailed)
+        sim_event (S, EV_UNUSED, 0, page, 0, 0);
+
+    S->pgt[page].prefetched = 0;
+    S->prefetch.numevicted ++;
+}
+
+// Function that shows the results of the prefetcher
+
+void print_prefetch_report (ssystem * S)
+{
+    sprefetch * F = &S->prefetch;
+    int p, unused;
+
+    for (p=unused=0; p<S->numpags; p++)
+        if (S->pgt[p].present && S->pgt[p].prefetched)
+            unused ++;
+
+    printf ("\nPrefetching (depth %d)\n", F->depth);
+    printf ("Pages prefetched:         %d\n", F->numissued);
+    printf ("  used (faults avoided):  %d\n", F->numused);
+    printf ("  evicted unused:         %d\n", F->numevicted);
+    printf ("  resident, not used yet: %d\n", unused);
+
+    if (F->numissued)
+        printf ("Accuracy:                 %.2f%%\n"
+                "Coverage:                 %.2f%%\n"
+                "Pollution:                %.2f%%\n",
+                100.0*F->numused/F->numissued,
+                100.0*F->numused/(F->numused+S->numpagefaults),
+                100.0*F->numevicted/F->numissued);
+}
@@ -9,6 +9,9 @@
 
 #include "./sim_paging.h"
 
+static int load_page(ssystem* S, int page, const int keep[], int nkeep);
+static int next_victim(ssystem* S);
+
 // Function that initialises the tables
 
 void init_tables(ssystem* S) {
@@ -35,6 +38,10 @@ void init_tables(ssystem* S) {
 
   // Empty circular list of occupied frames
   S->listoccupied = -1;
+
+  // Random generator, seeded like rand() by default
+  memset(&S->randomdata, 0, sizeof(S->randomdata));
+  initstate_r(1, S->randomstate, sizeof(S->randomstate), &S->randomdata);
 }
 
 // Functions that simulate the hardware of the MMU
@@ -60,12 +67,14 @@ unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
     frame = S->pgt[page].frame;
     physical_addr = frame * S->pagsz + offset;
 
+    if (S->pgt[page].prefetched)
+        prefetch_used(S, page);
+
     // Simular la referencia (contadores, modified, etc.)
     reference_page(S, page, op);
 
     if (S->detailed) {
-        printf("\t%c %u == P%d(F%d) + %d\n",
-               op, virtual_addr, page, frame, offset);
+        sim_event(S, EV_ACCESS, op, virtual_addr, frame, 0);
     }
 
     return physical_addr;
@@ -86,14 +95,36 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
   // TODO(student):
   //       Type in the code that simulates the Operating
   //
-    int page, victim, frame, last;
+    int page, i, n;
+    int batch[PREFETCH_MAX_DEPTH + 1];
 
     S->numpagefaults ++;
     page = virtual_address / S-> pagsz;
     if (S->detailed) {
-        printf ("@ PAGE_FAULT in P %d!\n", page);
+        sim_event (S, EV_FAULT, 0, page, 0, 0);
     }
 
+    pageout_daemon(S);
+
+    load_page(S, page, NULL, 0);
+
+    // Load ahead the next pages of the stream, if any, but
+    // never at the expense of the page that caused the fault
+    // or of the pages loaded ahead before them
+    batch[0] = page;
+    n = prefetch_candidates(S, page, batch + 1);
+
+    for (i = 1; i <= n && load_page(S, batch[i], batch, i) == 0; i++)
+        prefetch_loaded(S, batch[i]);
+}
+
+// Loads the page in a free frame or, if there are none, in the
+// frame of a victim. Fails, before the policy changes anything,
+// if the victim would be one of the nkeep pages of keep[]
+
+static int load_page(ssystem* S, int page, const int keep[], int nkeep) {
+    int victim, frame, last, k;
+
     if (S->listfree != -1) {
 	// There are free frames
         last = S->listfree;
@@ -110,16 +141,28 @@ void handle_page_fault(ssystem* S, unsigned virtual_address) {
         occupy_free_frame(S, frame, page);
     }else {
 	// There are not free frames
+        if (nkeep) {
+            victim = next_victim(S);
+            for (k = 0; k < nkeep; k++)
+                if (victim == keep[k]) return -1;
+        }
+        PROFILE_START(S, policymark);
         victim = choose_page_to_be_replaced(S);
+        PROFILE_STOP(S, policymark, PROF_CHOOSE);
         replace_page(S, victim, page);
     }
+
+    return 0;
 }
 
-static unsigned myrandom(unsigned from,  // <<--- random
-                         unsigned size) {
+static unsigned myrandom(ssystem* S,     // <<--- random
+                         unsigned from, unsigned size) {
   unsigned n;
+  int32_t r;
 
-  n = from + (unsigned)(rand() / (RAND_MAX + 1.0) * size);
+  // Same sequence as rand(), but each system has its own
+  random_r(&S->randomdata, &r);
+  n = from + (unsigned)(r / (RAND_MAX + 1.0) * size);
 
   if (n > from + size - 1)  // These checks shouldn't
     n = from + size - 1;    // be necessary, but it's
@@ -133,36 +176,51 @@ int choose_page_to_be_replaced(ssystem* S) {
     //Codigo que se debe cambiar
   int frame, victim;
 
-  frame = myrandom(0, S->numframes);  // <<--- random
+  frame = myrandom(S, 0, S->numframes);  // <<--- random
 
   victim = S->frt[frame].page;
 
   if (S->detailed)
-    printf(
-        "@ Choosing (at random) P%d of F%d to be "
-        "replaced\n",
-        victim, frame);
+    sim_event(S, EV_CHOOSE, 'R', victim, frame, 0);
 
   return victim;
 }
 
+// Page that choose_page_to_be_replaced would return, without
+// using up a random number
+
+static int next_victim(ssystem* S) {
+  struct random_data data = S->randomdata;
+  char state[sizeof(S->randomstate)];
+  int frame;
+
+  memcpy(state, S->randomstate, sizeof(state));
+  frame = myrandom(S, 0, S->numframes);
+  memcpy(S->randomstate, state, sizeof(state));
+  S->randomdata = data;
+
+  return S->frt[frame].page;
+}
+
 void replace_page(ssystem* S, int victim, int newpage) {
   int frame;
 
   frame = S->pgt[victim].frame;
 
+  if (S->pgt[victim].prefetched) prefetch_evicted(S, victim);
+
   if (S->pgt[victim].modified) {
     if (S->detailed)
-      printf(
-          "@ Writing modified P%d back (to disc) to "
-          "replace it\n",
-          victim);
+      sim_event(S, EV_WRITEBACK, 0, victim, 0, 0);
 
+    swap_write(S, victim);
     S->numpgwriteback++;
   }
 
   if (S->detailed)
-    printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
+    sim_event(S, EV_REPLACE, 0, victim, newpage, frame);
+
+  huge_evicted(S, victim);
 
   S->pgt[victim].present = 0;
 
@@ -171,12 +229,14 @@ void replace_page(ssystem* S, int victim, int newpage) {
   S->pgt[newpage].modified = 0;
 
   S->frt[frame].page = newpage;
+
+  swap_read(S, newpage);
 }
 
 void occupy_free_frame(ssystem* S, int frame, int page) {
 
     if (S->detailed)
-        printf("@ Storing P%d in F%d\n", page, frame);
+        sim_event(S, EV_STORE, 0, page, frame, 0);
 
     // 1. Actualizar la tabla de pginas
     S->pgt[page].frame     = frame;
@@ -187,6 +247,8 @@ void occupy_free_frame(ssystem* S, int frame, int page) {
     // 2. Actualizar la tabla de frames
     S->frt[frame].page = page;
 
+    swap_read(S, page);
+
     // RANDOM REPLACEMENT:
     // No se usa listoccupied, no se toca la lista
 
@@ -0,0 +1,453 @@
+/*
+    sim_pag_report.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_paging.h"
+
+// Summary of the pages, which doesn't grow with the address
+// space: the top-N pages by references and by page faults, and
+// how many pages had 0, 1, 2-3, 4-7... references and faults
+
+#define HIST_BUCKETS 33     // 0 and 2^0 .. 2^31
+
+// Bucket of a count: 0 -> 0, 1 -> 1, 2-3 -> 2, 4-7 -> 3...
+
+static int bucket (unsigned n)
+{
+    int b = 0;
+
+    while (n)
+    {
+        n >>= 1;
+        b ++;
+    }
+
+    return b;
+}
+
+static void histogram (const unsigned * count, int numpags,
+                       int hist[HIST_BUCKETS])
+{
+    int p;
+
+    memset (hist, 0, HIST_BUCKETS*sizeof(int));
+
+    for (p=0; p<numpags; p++)
+        hist[bucket(count[p])] ++;
+}
+
+// Stores in top[] the (at most) n pages with the highest counts,
+// from the highest down (the lowest page first if they tie), and
+// returns how many there are. A heap of n pages keeps the lowest
+// of them at the root, so it takes O(numpags log n)
+
+static int lower (const unsigned * count, int a, int b)
+{
+    return count[a] < count[b] || (count[a]==count[b] && a>b);
+}
+
+static void sift_down (int * heap, int n, int i,
+                       const unsigned * count)
+{
+    int c, p = heap[i];
+
+    for (; (c = 2*i+1) < n; i = c)
+    {
+        if (c+1<n && lower(count,heap[c+1],heap[c]))
+            c ++;
+
+        if (!lower(count,heap[c],p))
+            break;
+
+        heap[i] = heap[c];
+    }
+
+    heap[i] = p;
+}
+
+static int top_pages (const unsigned * count, int numpags, int n,
+                      int top[])
+{
+    int p, k, i, t;
+
+    for (p=k=0; p<numpags; p++)
+    {
+        if (!count[p])
+            continue;
+
+        if (k<n)
+        {
+            top[k++] = p;
+
+            if (k==n)
+                for (i=n/2-1; i>=0; i--)
+                    sift_down (top, n, i, count);
+        }
+        else if (lower(count,top[0],p))
+        {
+            top[0] = p;
+            sift_down (top, n, 0, count);
+        }
+    }
+
+    if (k<n)
+        for (i=k/2-1; i>=0; i--)
+            sift_down (top, k, i, count);
+
+    // Take the lowest out each time: sorted from the highest
+    for (i=k-1; i>0; i--)
+    {
+        t = top[0];
+        top[0] = top[i];
+        top[i] = t;
+        sift_down (top, i, 0, count);
+    }
+
+    return k;
+}
+
+// Range of pages of a bucket, as text ("0", "1", "2-3"...)
+
+static const char * bucket_name (int b, char * buf)
+{
+    if (b<2)
+        sprintf (buf, "%d", b);
+    else
+        sprintf (buf, "%u-%u", 1u<<(b-1), (1u<<(b-1))*2-1);
+
+    return buf;
+}
+
+// Function that shows the summary of the pages in the report
+
+void print_pages_report (ssystem * S)
+{
+    int * top, hist[2][HIST_BUCKETS], n, i, b, touched, faulted;
+    unsigned maxrefs = 0, maxfaults = 0;
+    char buf[32];
+
+    histogram (S->pagerefs, S->numpags, hist[0]);
+    histogram (S->pagefaults, S->numpags, hist[1]);
+
+    touched = S->numpags - hist[0][0];
+    faulted = S->numpags - hist[1][0];
+
+    for (i=0; i<S->numpags; i++)
+    {
+        if (S->pagerefs[i] > maxrefs)
+            maxrefs = S->pagerefs[i];
+
+        if (S->pagefaults[i] > maxfaults)
+            maxfaults = S->pagefaults[i];
+    }
+
+    printf ("Pages referenced:         %d of %d\n", touched, S->numpags);
+    printf ("Pages with page faults:   %d\n", faulted);
+    printf ("References per page:      %.1f on average, %u at most\n",
+            touched ? (double) (S->numrefsread+S->numrefswrite -
+                                S->numillegalrefs) / touched : 0.0,
+            maxrefs);
+    printf ("Page faults per page:     %.1f on average, %u at most\n",
+            faulted ? (double) S->numpagefaults / faulted : 0.0,
+            maxfaults);
+
+    top = (int*) malloc ((S->topn+1)*sizeof(int));
+
+    if (!top)
+        return;
+
+    n = top_pages (S->pagerefs, S->numpags, S->topn, top);
+    printf ("\nHottest pages:            ");
+
+    for (i=0; i<n; i++)
+        printf ("%sP%d (%u)", i ? ", " : "", page_number(S,top[i]),
+                S->pagerefs[top[i]]);
+
+    n = top_pages (S->pagefaults, S->numpags, S->topn, top);
+    printf ("\nMost faulted pages:       ");
+
+    for (i=0; i<n; i++)
+        printf ("%sP%d (%u)", i ? ", " : "", page_number(S,top[i]),
+                S->pagefaults[top[i]]);
+
+    printf ("\n\n%12s %12s %12s\n", "COUNT", "Pages(refs)",
+            "Pages(faults)");
+
+    for (b=0; b<HIST_BUCKETS; b++)
+        if (hist[0][b] || hist[1][b])
+            printf ("%12s %12d %12d\n", bucket_name(b,buf),
+                    hist[0][b], hist[1][b]);
+
+    free (top);
+}
+
+// Functions that write the time series. The main loop only
+// counts down the references of the interval (always, even
+// without a file), and series_point takes the counters of the
+// system, so that nothing else is done per reference
+
+#define SERIES_BUFFER (1<<16)
+
+int open_series (ssystem * S, const char * file, unsigned interval)
+{
+    sseries * T = &S->series;
+
+    T->file = fopen (file, "w");
+
+    if (!T->file)
+    {
+        perror (file);
+        return -1;
+    }
+
+    setvbuf (T->file, NULL, _IOFBF, SERIES_BUFFER);
+    fprintf (T->file, "# position refs faults writebacks "
+             "resident dirty\n");
+
+    T->interval = T->countdown = interval;
+    T->position = 0;
+    T->refs = S->numrefsread + S->numrefswrite;
+    T->faults = S->numpagefaults;
+    T->writebacks = S->numpgwriteback;
+
+    return 0;
+}
+
+void series_point (ssystem * S)
+{
+    sseries * T = &S->series;
+    int refs, resident, dirty, f, p;
+
+    T->countdown = T->interval;
+
+    if (!T->file)
+        return;
+
+    refs = S->numrefsread + S->numrefswrite - T->refs;
+
+    if (!refs)
+        return;
+
+    for (f=resident=dirty=0; f<S->numframes; f++)
+    {
+        p = S->frt[f].page;
+
+        if (p!=-1 && S->pgt[p].present)
+        {
+            resident ++;
+            dirty += S->pgt[p].modified!=0;
+        }
+    }
+
+    fprintf (T->file, "%llu %d %d %d %d %d\n", T->position, refs,
+             S->numpagefaults - T->faults,
+             S->numpgwriteback - T->writebacks, resident, dirty);
+
+    T->position += refs;
+    T->refs += refs;
+    T->faults = S->numpagefaults;
+    T->writebacks = S->numpgwriteback;
+}
+
+// Function that writes the last (partial) interval and closes
+// the series. Returns 0 if OK
+
+int close_series (ssystem * S)
+{
+    sseries * T = &S->series;
+    int ok;
+
+    if (!T->file)
+        return 0;
+
+    series_point (S);
+    ok = !ferror (T->file);
+
+    if (fclose(T->file)==EOF)
+        ok = 0;
+
+    T->file = NULL;
+    return ok ? 0 : -1;
+}
+
+// Function that shows the time spent in each phase of the
+// simulation, measured with SIM_PROFILE. The loop is the time
+// from the first reference to the last one; what is left of it
+// after the phases goes to the main loop itself (sampling,
+// counters, checkpoints...)
+
+void print_profile_report (ssystem * S)
+{
+    static const char * names[PROF_NUMPHASES] =
+    {
+        "Reading the trace", "References (hits)",
+        "Page faults", "  choosing the victim", "Report"
+    };
+    sprofile * F = &S->prof;
+    double ns = F->ticksperns>0 ? F->ticksperns : 1;
+    unsigned long long refs = F->count[PROF_HIT]+F->count[PROF_FAULT],
+                       rest = F->totalticks;
+    int i;
+
+    printf ("\n------------- PROFILE -------------\n\n");
+    printf ("%-22s %14s %7s %10s %12s\n", "PHASE", "Ticks", "%",
+            "Times", "Ticks/time");
+
+    for (i=0; i<PROF_NUMPHASES; i++)
+    {
+        printf ("%-22s %14llu %6.2f%% %10llu %12.1f\n", names[i],
+                F->ticks[i], 100.0*F->ticks[i]/(F->totalticks+1),
+                F->count[i],
+                F->count[i] ? (double) F->ticks[i]/F->count[i] : 0.0);
+
+        if (i!=PROF_CHOOSE && i!=PROF_REPORT)
+            rest -= rest>F->ticks[i] ? F->ticks[i] : rest;
+    }
+
+    printf ("%-22s %14llu %6.2f%%\n", "Rest of the loop", rest,
+            100.0*rest/(F->totalticks+1));
+
+    printf ("\nLoop:                     %.3f s (%.2f ticks/ns)\n",
+            F->totalticks/ns*1e-9, F->ticksperns);
+
+    if (refs)
+        printf ("Per reference:            %.1f ticks (%.1f ns)\n",
+                (double) F->totalticks/refs,
+                (double) F->totalticks/refs/ns);
+
+    if (F->count[PROF_FAULT])
+        printf ("Per page fault:           %.1f ticks (%.1f ns)\n",
+                (double) F->ticks[PROF_FAULT]/F->count[PROF_FAULT],
+                (double) F->ticks[PROF_FAULT]/F->count[PROF_FAULT]/ns);
+}
+
+// Function that writes the report to a file, as JSON or as CSV
+// (one "section,key,value" line per number). The file gets a
+// large buffer so that it is written in a few big blocks.
+// Returns 0 if OK
+
+#define REPORT_BUFFER (1<<16)
+
+int write_report (ssystem * S, const char * file, char format)
+{
+    FILE * f;
+    int * top, hist[2][HIST_BUCKETS], n, i, k, b, first, ok;
+    const unsigned * count[2] = { S->pagerefs, S->pagefaults };
+    const char * name[2] = { "references", "faults" };
+    const char * topname[2] = { "hottest", "most_faulted" };
+    char buf[32];
+
+    struct
+    {
+        const char * key;
+        unsigned long long value;
+    }
+    summary[] =
+    {
+        { "pagesize",   S->pagsz },
+        { "pages",      S->numpags },
+        { "frames",     S->numframes },
+        { "reads",      S->numrefsread },
+        { "writes",     S->numrefswrite },
+        { "faults",     S->numpagefaults },
+        { "writebacks", S->numpgwriteback },
+        { "illegal",    S->numillegalrefs },
+    };
+
+    f = fopen (file, "w");
+    top = (int*) malloc ((S->topn+1)*sizeof(int));
+
+    if (!f || !top)
+    {
+        if (f)
+            fclose (f);
+        else
+            perror (file);
+
+        free (top);
+        return -1;
+    }
+
+    setvbuf (f, NULL, _IOFBF, REPORT_BUFFER);
+
+    histogram (S->pagerefs, S->numpags, hist[0]);
+    histogram (S->pagefaults, S->numpags, hist[1]);
+
+    if (format=='j')
+        fprintf (f, "{\n  \"summary\": {");
+    else
+        fprintf (f, "section,key,value\n");
+
+    for (i=0; i<sizeof(summary)/sizeof(summary[0]); i++)
+        if (format=='j')
+            fprintf (f, "%s\n    \"%s\": %llu", i ? "," : "",
+                     summary[i].key, summary[i].value);
+        else
+            fprintf (f, "summary,%s,%llu\n", summary[i].key,
+                     summary[i].value);
+
+    if (format=='j')
+        fprintf (f, "\n  }");
+
+    for (k=0; k<2; k++)
+    {
+        n = top_pages (count[k], S->numpags, S->topn, top);
+
+        if (format=='j')
+            fprintf (f, ",\n  \"%s\": [", topname[k]);
+
+        for (i=0; i<n; i++)
+            if (format=='j')
+                fprintf (f, "%s\n    { \"page\": %d, \"%s\": %u }",
+                         i ? "," : "", page_number(S,top[i]), name[k],
+                         count[k][top[i]]);
+            else
+                fprintf (f, "%s,%d,%u\n", topname[k],
+                         page_number(S,top[i]),
+                         count[k][top[i]]);
+
+        if (format=='j')
+            fprintf (f, "%s]", n ? "\n  " : "");
+    }
+
+    for (k=0; k<2; k++)
+    {
+        if (format=='j')
+            fprintf (f, ",\n  \"%s_histogram\": [", name[k]);
+
+        for (b=first=0; b<HIST_BUCKETS; b++)
+        {
+            if (!hist[k][b])
+                continue;
+
+            if (format=='j')
+                fprintf (f, "%s\n    { \"count\": \"%s\", "
+                         "\"pages\": %d }", first++ ? "," : "",
+                         bucket_name(b,buf), hist[k][b]);
+            else
+                fprintf (f, "%s_histogram,%s,%d\n", name[k],
+                         bucket_name(b,buf), hist[k][b]);
+        }
+
+        if (format=='j')
+            fprintf (f, "\n  ]");
+    }
+
+    if (format=='j')
+        fprintf (f, "\n}\n");
+
+    free (top);
+    ok = !ferror (f);
+
+    if (fclose(f)==EOF || !ok)
+    {
+        fprintf (stderr, "ERROR: can't write %s\n", file);
+        return -1;
+    }
+
+    return 0;
+}
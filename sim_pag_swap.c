@@ -0,0 +1,150 @@
+/*
+    sim_pag_swap.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim_paging.h"
+
+// Size of one element of the array, in bytes (sizeof(thing))
+
+#define ELEMENT_SIZE 8
+
+// Time needed to transfer npages pages to/from the device
+
+static unsigned long long transfer_time (ssystem * S, int npages)
+{
+    return (unsigned long long) npages * S->pagsz * ELEMENT_SIZE
+           * 1000 / S->swap.bandwidth;
+}
+
+// Synchronous operation: the process waits until the device
+// is free and the operation is over
+
+static void wait_for_device (ssystem * S, unsigned long long cost)
+{
+    sswap * W = &S->swap;
+    unsigned long long start;
+
+    start = W->busyuntil > W->now ? W->busyuntil : W->now;
+    W->busyuntil = start + cost;
+    W->stall += W->busyuntil - W->now;
+    W->now = W->busyuntil;
+}
+
+// A page gets a swap slot the first time it is written out,
+// and keeps it: later write-backs of the page overwrite the same
+// slot, so the slots in use are the pages that have been written
+// out at least once (and they never go down)
+
+static void assign_slot (sswap * W, int page)
+{
+    if (W->slot[page]==-1)
+        W->slot[page] = W->nextslot++;
+}
+
+// Function that simulates reading a page into its frame
+
+void swap_read (ssystem * S, int page)
+{
+    if (!S->swap.enabled)
+        return;
+
+    wait_for_device (S, S->swap.readlat + transfer_time(S,1));
+    S->swap.numreads ++;
+}
+
+// Function that simulates writing a modified page out to disc
+// before its frame can be reused
+
+void swap_write (ssystem * S, int page)
+{
+    if (!S->swap.enabled)
+        return;
+
+    assign_slot (&S->swap, page);
+    wait_for_device (S, S->swap.writelat + transfer_time(S,1));
+    S->swap.numwrites ++;
+}
+
+// Function that simulates the pageout daemon. If there are
+// fewer free frames than the watermark and the device is idle,
+// it looks for up to 'cluster' modified pages, going round the
+// frames like a clock hand, and writes all of them out in one
+// go, as one clustered write. Only a run of consecutive slots
+// is written for one latency: each break in the slot order
+// costs another one. The process doesn't wait for this write,
+// but its next I/O will have to wait for it
+
+void pageout_daemon (ssystem * S)
+{
+    sswap * W = &S->swap;
+    int f, n, nruns, last, nfree, looked, page;
+
+    if (!W->enabled || W->busyuntil > W->now)
+        return;
+
+    // Count the free frames (not more than needed)
+    nfree = 0;
+
+    if (S->listfree != -1)
+        for (f=S->frt[S->listfree].next, nfree=1;
+             f!=S->listfree && nfree<W->watermark;
+             f=S->frt[f].next)
+            nfree ++;
+
+    if (nfree>=W->watermark)
+        return;
+
+    last = -2;  // No slot follows it
+    nruns = 0;
+
+    for (n=looked=0; n<W->cluster && looked<S->numframes; looked++)
+    {
+        page = S->frt[W->hand].page;
+
+        if (page!=-1 && S->pgt[page].modified)
+        {
+            if (S->detailed)
+                sim_event (S, EV_CLEAN, 0, page, W->hand, 0);
+
+            S->pgt[page].modified = 0;
+            assign_slot (W, page);
+            if (W->slot[page]!=last+1)
+                nruns ++;
+            last = W->slot[page];
+            S->numpgwriteback ++;
+            n ++;
+        }
+
+        W->hand = (W->hand+1) % S->numframes;
+    }
+
+    if (n)
+    {
+        W->busyuntil = W->now + (unsigned long long) nruns * W->writelat
+                       + transfer_time(S,n);
+        W->numcleaned += n;
+        W->numclusters ++;
+    }
+}
+
+// Function that shows the results of the swap device
+
+void print_swap_report (ssystem * S)
+{
+    sswap * W = &S->swap;
+    unsigned refs = S->numrefsread + S->numrefswrite;
+
+    printf ("Pages read in:            %d\n", W->numreads);
+    printf ("Pages written by faults:  %d\n", W->numwrites);
+    printf ("Pages cleaned by daemon:  %d (%d clustered writes)\n",
+            W->numcleaned, W->numclusters);
+    printf ("Swap slots in use (peak): %d\n", W->nextslot);
+    printf ("Total time:               %llu ns\n", W->now);
+    printf ("I/O stalls:               %llu ns (%.2f%%)\n",
+            W->stall, W->now ? 100.0*W->stall/W->now : 0.0);
+    printf ("Effective access time:    %.2f ns\n",
+            refs ? W->now/(double)refs : 0.0);
+}
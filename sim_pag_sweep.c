@@ -0,0 +1,1054 @@
+/*
+    sim_pag_sweep.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <math.h>
+
+#include "sim_paging.h"
+#include "trace.h"
+
+// Runs every combination of algorithms, initial orders, sizes,
+// page sizes, numbers of frames and policies in a single process
+// and writes one line of results per combination (CSV).
+//
+// Each trace is generated once (a job that runs gen_trace and
+// keeps the references in memory) and shared by all the
+// simulations that only differ in page size, frames or policy,
+// which are spawned when the trace is ready. The jobs run on a
+// pool of threads with work stealing: each thread takes its own
+// jobs from the bottom of its deque (the newest first) and, when
+// it runs out of them, steals the oldest ones of another thread.
+// A thread that finds no job anywhere sleeps until some thread
+// spawns new ones or the last job ends.
+//
+// The results can also be checked against those of a previous
+// run (--check): the page faults, write-backs and illegal
+// references must be exactly the same, so any change meant to
+// make the simulators faster can be shown not to change what
+// they simulate. With --baseline, the references simulated per
+// second by each policy are compared with those of an earlier
+// run on the same machine, and a policy that became slower than
+// --tolerance fails the check too.
+
+// The policies, built with -DPOLICY=name
+
+#define DECLARE_POLICY(p) \
+    void p##_init_tables (ssystem *); \
+    unsigned p##_sim_mmu (ssystem *, unsigned, char);
+
+DECLARE_POLICY(random)
+DECLARE_POLICY(lru)
+DECLARE_POLICY(fifo)
+DECLARE_POLICY(fifo2ch)
+DECLARE_POLICY(ws)
+DECLARE_POLICY(pff)
+
+static const spolicy policies[] =
+{
+    { "random",  random_init_tables,  random_sim_mmu },
+    { "lru",     lru_init_tables,     lru_sim_mmu },
+    { "fifo",    fifo_init_tables,    fifo_sim_mmu },
+    { "fifo2ch", fifo2ch_init_tables, fifo2ch_sim_mmu },
+    { "ws",      ws_init_tables,      ws_sim_mmu },
+    { "pff",     pff_init_tables,     pff_sim_mmu },
+};
+
+#define NUM_POLICIES (sizeof(policies)/sizeof(policies[0]))
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
+#define VALID_INIT_ORD "ASC/DES/RAN"
+
+#define MAX_LIST 1024       // Max. values of a parameter
+
+// Structure holding data of the parameters passed through
+// the command line (lists of values of every parameter)
+
+typedef struct
+{
+    int numalg, numinit, numsizes, numpagsz, numframes, numpol;
+    char alg[8][4], init[3][4];
+    int sizes[MAX_LIST], pagsz[MAX_LIST], frames[MAX_LIST];
+    const spolicy * pol[NUM_POLICIES];
+    unsigned tau;               // WS window / PFF threshold
+    int threads;
+    const char * outfile;       // Results (NULL = stdout)
+    const char * checkfile;     // Expected results (golden)
+    const char * basefile;      // Results of a run to compare speed
+    double tolerance;           // % of speed that can be lost
+}
+sparameters;
+
+// A trace in memory: element numbers, with the top bit set on
+// writes. It is freed when its last simulation ends
+
+#define WRITE_BIT 0x80000000u
+
+typedef struct
+{
+    int alg, init, size;        // Indices in the parameters
+    unsigned totelem;
+    unsigned * refs;
+    unsigned long numrefs;
+    atomic_int pending;         // Simulations not finished yet
+    int failed;
+}
+sdecoded;
+
+// A job: decode a trace (sim==-1) or simulate it with one page
+// size, number of frames and policy. The simulations of trace t
+// are the jobs firstsim[t] .. firstsim[t]+numsims-1
+
+typedef struct
+{
+    int trace;
+    int pagsz, numframes;
+    const spolicy * pol;
+    int faults, writebacks, illegal;   // Results
+    double seconds;
+    int done;
+}
+sjob;
+
+// Deque of jobs of a thread. The owner pushes and pops at the
+// bottom; the others steal from the top. It starts with room for
+// the traces of the thread and the simulations of one of them,
+// and grows if the thread spawns more before they are taken
+
+typedef struct
+{
+    sjob ** jobs;
+    int top, bottom, size;
+    pthread_mutex_t lock;
+}
+sdeque;
+
+typedef struct
+{
+    const sparameters * P;
+    sdecoded * traces;
+    sjob * jobs;                // Trace jobs first, then simulations
+    int numtraces, numsims;
+    sdeque * deques;
+    atomic_int pending;         // Jobs not finished yet
+    atomic_int queued;          // Jobs waiting in the deques
+    pthread_mutex_t lock;       // To sleep when there are none
+    pthread_cond_t wakeup;      // New jobs, or the last one ended
+}
+spool;
+
+typedef struct
+{
+    spool * pool;
+    int id;
+}
+sworker;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+void * worker_thread (void *);
+void run_job (spool *, int id, sjob *);
+void write_results (FILE *, const spool *);
+int check_results (const spool *, const char * file);
+int check_speed (const spool *, const char * file, double tolerance);
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// Estimated cost of a trace (and its simulations): the number
+// of references grows as n^2 in BUB, INS and SEL and as n log n
+// in the others
+
+static const spool * sorted_pool;
+
+static double trace_cost (const spool * pool, int t)
+{
+    const sparameters * P = pool->P;
+    const sdecoded * D = &pool->traces[t];
+    double n = P->sizes[D->size];
+
+    if (strstr("BUB/INS/SEL",P->alg[D->alg]))
+        return n*n;
+
+    return n*log2(n+1);
+}
+
+static int compare_cost (const void * a, const void * b)
+{
+    double ca = trace_cost (sorted_pool, *(const int*)a),
+           cb = trace_cost (sorted_pool, *(const int*)b);
+
+    return ca<cb ? -1 : ca>cb;
+}
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    spool pool;
+    sworker * W;
+    pthread_t * tid;
+    int a, i, n, t, j, k, f, p, perthread, * order;
+    double start;
+    FILE * out;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    pool.P = &P;
+    pool.numtraces = P.numalg * P.numinit * P.numsizes;
+    pool.numsims = P.numpagsz * P.numframes * P.numpol;
+    pool.traces = (sdecoded*) calloc (pool.numtraces, sizeof(sdecoded));
+    pool.jobs = (sjob*) calloc ((size_t) pool.numtraces *
+                                (pool.numsims+1), sizeof(sjob));
+    pool.deques = (sdeque*) calloc (P.threads, sizeof(sdeque));
+    W = (sworker*) malloc (P.threads*sizeof(sworker));
+    tid = (pthread_t*) malloc (P.threads*sizeof(pthread_t));
+
+    if (!pool.traces || !pool.jobs || !pool.deques || !W || !tid)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    // Every deque starts with room for its share of the traces
+    // plus the simulations of one of them
+    perthread = (pool.numtraces+P.threads-1)/P.threads +
+                pool.numsims;
+
+    for (i=0; i<P.threads; i++)
+    {
+        pool.deques[i].jobs = (sjob**) malloc (perthread*sizeof(sjob*));
+        pool.deques[i].size = perthread;
+        pthread_mutex_init (&pool.deques[i].lock, NULL);
+
+        if (!pool.deques[i].jobs)
+        {
+            fprintf (stderr, "ERROR: not enough dynamic memory\n");
+            return -1;
+        }
+    }
+
+    // Jobs: the traces, and the simulations of each trace
+    for (t=a=0; a<P.numalg; a++)
+        for (i=0; i<P.numinit; i++)
+            for (n=0; n<P.numsizes; n++, t++)
+            {
+                pool.traces[t].alg = a;
+                pool.traces[t].init = i;
+                pool.traces[t].size = n;
+                atomic_init (&pool.traces[t].pending, pool.numsims);
+                pool.jobs[t].trace = t;
+                pool.jobs[t].pol = NULL;
+
+                j = pool.numtraces + t*pool.numsims;
+
+                for (k=0; k<P.numpagsz; k++)
+                    for (f=0; f<P.numframes; f++)
+                        for (p=0; p<P.numpol; p++, j++)
+                        {
+                            pool.jobs[j].trace = t;
+                            pool.jobs[j].pagsz = P.pagsz[k];
+                            pool.jobs[j].numframes = P.frames[f];
+                            pool.jobs[j].pol = P.pol[p];
+                        }
+            }
+
+    // Traces dealt out round robin from the cheapest one; the
+    // owners start with the most expensive (pushed last), and the
+    // cheap ones are left at the top for the thieves
+    order = (int*) malloc (pool.numtraces*sizeof(int));
+
+    if (!order)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (t=0; t<pool.numtraces; t++)
+        order[t] = t;
+
+    sorted_pool = &pool;
+    qsort (order, pool.numtraces, sizeof(int), compare_cost);
+
+    for (t=0; t<pool.numtraces; t++)
+    {
+        sdeque * D = &pool.deques[t % P.threads];
+        D->jobs[D->bottom++] = &pool.jobs[order[t]];
+    }
+
+    free (order);
+
+    atomic_init (&pool.pending, pool.numtraces*(pool.numsims+1));
+    atomic_init (&pool.queued, pool.numtraces);
+    pthread_mutex_init (&pool.lock, NULL);
+    pthread_cond_init (&pool.wakeup, NULL);
+
+    start = now ();
+
+    for (i=0; i<P.threads; i++)
+    {
+        W[i].pool = &pool;
+        W[i].id = i;
+
+        if (pthread_create(&tid[i],NULL,worker_thread,&W[i]))
+        {
+            fprintf (stderr, "ERROR: can't start a thread\n");
+            return -1;
+        }
+    }
+
+    for (i=0; i<P.threads; i++)
+        pthread_join (tid[i], NULL);
+
+    fprintf (stderr, "# %d traces, %d simulations, %d threads: "
+             "%.3f s\n", pool.numtraces, pool.numtraces*pool.numsims,
+             P.threads, now()-start);
+
+    out = P.outfile ? fopen (P.outfile, "w") : stdout;
+
+    if (!out)
+    {
+        perror (P.outfile);
+        return -1;
+    }
+
+    write_results (out, &pool);
+
+    if (out!=stdout && fclose(out))
+    {
+        perror (P.outfile);
+        return -1;
+    }
+
+    for (t=0; t<pool.numtraces; t++)
+        if (pool.traces[t].failed)
+            return -1;
+
+    if (P.checkfile && check_results(&pool,P.checkfile)<0)
+        return -1;
+
+    if (P.basefile && check_speed(&pool,P.basefile,P.tolerance)<0)
+        return -1;
+
+    return 0;
+}
+
+// Functions of the deques
+
+static int push_job (spool * pool, sdeque * D, sjob * J)
+{
+    sjob ** jobs;
+
+    pthread_mutex_lock (&D->lock);
+
+    // Full: move the jobs down to the start or, if they are
+    // already there, make room for twice as many
+    if (D->bottom == D->size)
+    {
+        if (D->top)
+        {
+            memmove (D->jobs, D->jobs+D->top,
+                     (D->bottom-D->top)*sizeof(sjob*));
+            D->bottom -= D->top;
+            D->top = 0;
+        }
+        else
+        {
+            jobs = (sjob**) realloc (D->jobs, 2*D->size*sizeof(sjob*));
+
+            if (!jobs)
+            {
+                pthread_mutex_unlock (&D->lock);
+                return -1;
+            }
+
+            D->jobs = jobs;
+            D->size *= 2;
+        }
+    }
+
+    D->jobs[D->bottom++] = J;
+    atomic_fetch_add (&pool->queued, 1);
+    pthread_mutex_unlock (&D->lock);
+    return 0;
+}
+
+// Wakes up the threads that found nothing to do
+
+static void wake_workers (spool * pool)
+{
+    pthread_mutex_lock (&pool->lock);
+    pthread_cond_broadcast (&pool->wakeup);
+    pthread_mutex_unlock (&pool->lock);
+}
+
+static sjob * pop_job (spool * pool, sdeque * D)
+{
+    sjob * J = NULL;
+
+    pthread_mutex_lock (&D->lock);
+
+    if (D->bottom > D->top)
+    {
+        J = D->jobs[--D->bottom];
+        atomic_fetch_sub (&pool->queued, 1);
+    }
+
+    if (D->bottom == D->top)
+        D->bottom = D->top = 0;
+
+    pthread_mutex_unlock (&D->lock);
+    return J;
+}
+
+static sjob * steal_job (spool * pool, sdeque * D)
+{
+    sjob * J = NULL;
+
+    pthread_mutex_lock (&D->lock);
+
+    if (D->bottom > D->top)
+    {
+        J = D->jobs[D->top++];
+        atomic_fetch_sub (&pool->queued, 1);
+    }
+
+    if (D->bottom == D->top)
+        D->bottom = D->top = 0;
+
+    pthread_mutex_unlock (&D->lock);
+    return J;
+}
+
+void * worker_thread (void * arg)
+{
+    sworker * W = arg;
+    spool * pool = W->pool;
+    int n = pool->P->threads, i;
+    sjob * J;
+
+    while (atomic_load(&pool->pending) > 0)
+    {
+        J = pop_job (pool, &pool->deques[W->id]);
+
+        // Nothing left here: steal from the others
+        for (i=1; !J && i<n; i++)
+            J = steal_job (pool, &pool->deques[(W->id+i) % n]);
+
+        if (J)
+        {
+            run_job (pool, W->id, J);
+
+            if (atomic_fetch_sub(&pool->pending,1) == 1)
+                wake_workers (pool);
+        }
+        else
+        {
+            // Nothing anywhere: wait for the jobs that the traces
+            // being decoded will spawn, or for the end
+            pthread_mutex_lock (&pool->lock);
+
+            while (!atomic_load(&pool->queued) &&
+                   atomic_load(&pool->pending) > 0)
+                pthread_cond_wait (&pool->wakeup, &pool->lock);
+
+            pthread_mutex_unlock (&pool->lock);
+        }
+    }
+
+    return NULL;
+}
+
+// Reads a whole trace into memory. Returns 0 if OK
+
+static int decode_trace (const sparameters * P, sdecoded * D)
+{
+    strace T;
+    unsigned long size = 1<<16;
+    unsigned * refs;
+    char op;
+    unsigned u;
+    int r = 0;
+
+    if (trace_open(&T,NULL,P->alg[D->alg],P->init[D->init],
+                   P->sizes[D->size])<0)
+        return -1;
+
+    D->totelem = T.totelem;
+    D->numrefs = 0;
+    D->refs = (unsigned*) malloc (size*sizeof(unsigned));
+
+    while (D->refs && (r = trace_next(&T,&op,&u)) > 0)
+    {
+        if (D->numrefs==size)
+        {
+            size *= 2;
+            refs = (unsigned*) realloc (D->refs, size*sizeof(unsigned));
+
+            if (!refs)
+            {
+                free (D->refs);
+                D->refs = NULL;
+                break;
+            }
+
+            D->refs = refs;
+        }
+
+        D->refs[D->numrefs++] = op=='W' ? u|WRITE_BIT : u;
+    }
+
+    if (!D->refs)
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+
+    if (trace_close(&T)<0 || !D->refs || r<0)
+    {
+        free (D->refs);
+        D->refs = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Simulates a trace with one configuration. Returns 0 if OK
+
+static int simulate (const sparameters * P, const sdecoded * D,
+                     sjob * J)
+{
+    ssystem S;
+    unsigned long i;
+    unsigned u;
+    double start = now ();
+
+    memset (&S, 0, sizeof(S));
+    S.pagsz = J->pagsz;
+    S.numpags = (D->totelem+J->pagsz-1) / J->pagsz;
+    S.numframes = J->numframes;
+    S.tau = P->tau;
+    S.pgt = (spage*) malloc (S.numpags*sizeof(spage));
+    S.frt = (sframe*) malloc (S.numframes*sizeof(sframe));
+
+    if (S.pgt && S.frt)
+        J->pol->init_tables (&S);
+    else
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+
+    if (!S.pgt || !S.frt || S.initerror)
+    {
+        free (S.pgt);
+        free (S.frt);
+        return -1;
+    }
+
+    for (i=0; i<D->numrefs; i++)
+    {
+        u = D->refs[i];
+        J->pol->sim_mmu (&S, u & ~WRITE_BIT, u & WRITE_BIT ? 'W' : 'R');
+    }
+
+    J->faults = S.numpagefaults;
+    J->writebacks = S.numpgwriteback;
+    J->illegal = S.numillegalrefs;
+    J->seconds = now() - start;
+
+    free (S.pgt);
+    free (S.frt);
+    free (S.window);
+    return 0;
+}
+
+void run_job (spool * pool, int id, sjob * J)
+{
+    sdecoded * D = &pool->traces[J->trace];
+    int j, first = pool->numtraces + J->trace*pool->numsims;
+
+    if (!J->pol)
+    {
+        // Trace ready: its simulations go to this thread, where
+        // the others can steal them
+        if (decode_trace(pool->P,D)<0)
+        {
+            D->failed = 1;
+            atomic_fetch_sub (&pool->pending, pool->numsims);
+            return;
+        }
+
+        for (j=first+pool->numsims-1; j>=first; j--)
+            if (push_job(pool,&pool->deques[id],&pool->jobs[j])<0)
+            {
+                // The simulations not spawned are given up
+                fprintf (stderr, "ERROR: not enough dynamic memory\n");
+                D->failed = 1;
+                atomic_fetch_sub (&pool->pending, j-first+1);
+
+                if (atomic_fetch_sub(&D->pending,j-first+1) == j-first+1)
+                {
+                    free (D->refs);
+                    D->refs = NULL;
+                }
+
+                break;
+            }
+
+        wake_workers (pool);
+        return;
+    }
+
+    if (simulate(pool->P,D,J)<0)
+        D->failed = 1;
+    else
+        J->done = 1;
+
+    if (atomic_fetch_sub(&D->pending,1) == 1)
+    {
+        free (D->refs);
+        D->refs = NULL;
+    }
+}
+
+// Function that writes the results, in the order of the
+// parameters
+
+void write_results (FILE * out, const spool * pool)
+{
+    const sparameters * P = pool->P;
+    const sdecoded * D;
+    const sjob * J;
+    int t, j;
+
+    fprintf (out, "algorithm,initial,numelem,pagesize,numframes,"
+             "policy,references,faults,writebacks,illegal,seconds\n");
+
+    for (t=0; t<pool->numtraces; t++)
+    {
+        D = &pool->traces[t];
+
+        for (j=0; j<pool->numsims; j++)
+        {
+            J = &pool->jobs[pool->numtraces + t*pool->numsims + j];
+
+            if (!J->done)
+                continue;
+
+            fprintf (out, "%s,%s,%d,%d,%d,%s,%lu,%d,%d,%d,%.6f\n",
+                     P->alg[D->alg], P->init[D->init],
+                     P->sizes[D->size], J->pagsz, J->numframes,
+                     J->pol->name, D->numrefs, J->faults,
+                     J->writebacks, J->illegal, J->seconds);
+        }
+    }
+}
+
+// A line of results read from a CSV file written by write_results
+
+typedef struct
+{
+    char alg[4], init[4], policy[16];
+    int size, pagsz, numframes, faults, writebacks, illegal;
+    unsigned long numrefs;
+    double seconds;
+}
+sresultline;
+
+static int read_result (FILE * f, sresultline * L)
+{
+    char line[256];
+
+    while (fgets(line,sizeof(line),f))
+        if (sscanf(line,"%3[A-Z],%3[A-Z],%d,%d,%d,%15[a-z0-9],%lu,"
+                   "%d,%d,%d,%lf", L->alg, L->init, &L->size,
+                   &L->pagsz, &L->numframes, L->policy, &L->numrefs,
+                   &L->faults, &L->writebacks, &L->illegal,
+                   &L->seconds)==11)
+            return 1;
+
+    return 0;
+}
+
+// Looks up the simulation of a line (NULL if it wasn't run)
+
+static const sjob * find_job (const spool * pool, const sresultline * L)
+{
+    const sparameters * P = pool->P;
+    const sdecoded * D;
+    const sjob * J;
+    int t, j;
+
+    for (t=0; t<pool->numtraces; t++)
+    {
+        D = &pool->traces[t];
+
+        if (strcmp(P->alg[D->alg],L->alg) ||
+            strcmp(P->init[D->init],L->init) ||
+            P->sizes[D->size]!=L->size)
+            continue;
+
+        for (j=0; j<pool->numsims; j++)
+        {
+            J = &pool->jobs[pool->numtraces + t*pool->numsims + j];
+
+            if (J->done && J->pagsz==L->pagsz &&
+                J->numframes==L->numframes &&
+                !strcmp(J->pol->name,L->policy))
+                return J;
+        }
+    }
+
+    return NULL;
+}
+
+// Function that compares the results with those of a file: every
+// simulation must be there, with the same numbers. Returns 0 if
+// they are identical
+
+int check_results (const spool * pool, const char * file)
+{
+    sresultline L;
+    const sjob * J;
+    const sdecoded * D;
+    FILE * f = fopen (file, "r");
+    int found = 0, wrong = 0;
+
+    if (!f)
+    {
+        perror (file);
+        return -1;
+    }
+
+    while (read_result(f,&L))
+    {
+        J = find_job (pool, &L);
+
+        if (!J)
+            continue;
+
+        D = &pool->traces[J->trace];
+        found ++;
+
+        if (D->numrefs==L.numrefs && J->faults==L.faults &&
+            J->writebacks==L.writebacks && J->illegal==L.illegal)
+            continue;
+
+        fprintf (stderr, "MISMATCH %s %s %d, pagsz %d, %d frames, %s:"
+                 " %lu refs, %d faults, %d writebacks, %d illegal"
+                 " (expected %lu, %d, %d, %d)\n", L.alg, L.init,
+                 L.size, L.pagsz, L.numframes, L.policy, D->numrefs,
+                 J->faults, J->writebacks, J->illegal, L.numrefs,
+                 L.faults, L.writebacks, L.illegal);
+        wrong ++;
+    }
+
+    fclose (f);
+
+    if (found<pool->numtraces*pool->numsims)
+        fprintf (stderr, "ERROR: only %d of the %d simulations are in "
+                 "%s\n", found, pool->numtraces*pool->numsims, file);
+    else if (!wrong)
+        fprintf (stderr, "# %d simulations identical to %s\n",
+                 found, file);
+
+    return wrong || found<pool->numtraces*pool->numsims ? -1 : 0;
+}
+
+// Function that compares, policy by policy, the references
+// simulated per second with those of a file. Returns 0 if no
+// policy became slower than the tolerance
+
+int check_speed (const spool * pool, const char * file,
+                 double tolerance)
+{
+    const sparameters * P = pool->P;
+    double refs[NUM_POLICIES][2], secs[NUM_POLICIES][2], speed, base;
+    sresultline L;
+    const sjob * J;
+    FILE * f = fopen (file, "r");
+    int p, slower = 0;
+
+    if (!f)
+    {
+        perror (file);
+        return -1;
+    }
+
+    memset (refs, 0, sizeof(refs));
+    memset (secs, 0, sizeof(secs));
+
+    // Only the simulations run now, with both times
+    while (read_result(f,&L))
+    {
+        J = find_job (pool, &L);
+
+        if (!J)
+            continue;
+
+        for (p=0; P->pol[p]!=J->pol; p++)
+            ;
+
+        refs[p][0] += pool->traces[J->trace].numrefs;
+        secs[p][0] += J->seconds;
+        refs[p][1] += L.numrefs;
+        secs[p][1] += L.seconds;
+    }
+
+    fclose (f);
+
+    fprintf (stderr, "# Mrefs/s against %s\n# %-8s %12s %12s %8s\n",
+             file, "policy", "now", "baseline", "change");
+
+    for (p=0; p<P->numpol; p++)
+    {
+        if (!secs[p][0] || !secs[p][1])
+        {
+            fprintf (stderr, "# %-8s not in %s\n", P->pol[p]->name,
+                     file);
+            continue;
+        }
+
+        speed = refs[p][0]/secs[p][0]/1e6;
+        base = refs[p][1]/secs[p][1]/1e6;
+
+        fprintf (stderr, "# %-8s %12.2f %12.2f %+7.1f%%%s\n",
+                 P->pol[p]->name, speed, base, 100*(speed/base-1),
+                 speed < base*(1-tolerance/100) ? "  SLOWER" : "");
+
+        if (speed < base*(1-tolerance/100))
+            slower ++;
+    }
+
+    return slower ? -1 : 0;
+}
+
+// Function that parses a list of numbers: "A,B,C", "A-B" (every
+// number from A to B), "A-B:S" (in steps of S) or "A-B*M"
+// (multiplying by M), or a combination of them ("1-8,16,32").
+// Returns the number of values or -1
+
+static int parse_numbers (const char * s, int v[], int min)
+{
+    int n = 0, a, b, step, len;
+    char kind;
+
+    for (;;)
+    {
+        kind = '+';
+        step = 1;
+
+        if (sscanf(s,"%d-%d%n",&a,&b,&len)==2)
+        {
+            if (s[len]==':' || s[len]=='*')
+            {
+                kind = s[len];
+                s += len+1;
+
+                if (sscanf(s,"%d%n",&step,&len)!=1)
+                    return -1;
+            }
+        }
+        else if (sscanf(s,"%d%n",&a,&len)==1)
+            b = a;
+        else
+            return -1;
+
+        s += len;
+
+        if (a<min || b<a || step<1 || (kind=='*' && step<2))
+            return -1;
+
+        for (; a<=b; a = kind=='*' ? a*step : a+step)
+        {
+            if (n==MAX_LIST)
+                return -1;
+
+            v[n++] = a;
+        }
+
+        if (*s=='\0')
+            return n;
+
+        if (*s++!=',')
+            return -1;
+    }
+}
+
+// Function that parses a list of names separated by commas, or
+// "all" (every valid name). Returns the number of names or -1
+
+static int parse_names (const char * s, char v[][4], int max,
+                        const char * valid)
+{
+    int n = 0;
+
+    if (!strcmp(s,"all"))
+        s = valid;
+
+    for (;;)
+    {
+        if (n==max || strlen(s)<3 || (s[3]!='\0' && s[3]!=',' &&
+                                      s[3]!='/'))
+            return -1;
+
+        strncpy (v[n], s, 3);
+        v[n][3] = '\0';
+
+        if (strchr(v[n],'/') || !strstr(valid,v[n]))
+            return -1;
+
+        n ++;
+        s += 3;
+
+        if (*s=='\0')
+            return n;
+
+        s ++;
+    }
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i;
+
+    // Default parameters
+    p->numalg = parse_names ("MER", p->alg, 8, VALID_ALGORITHMS);
+    p->numinit = parse_names ("RAN", p->init, 3, VALID_INIT_ORD);
+    p->numsizes = parse_numbers ("1000", p->sizes, 2);
+    p->numpagsz = parse_numbers ("16", p->pagsz, 1);
+    p->numframes = parse_numbers ("32", p->frames, 1);
+    p->numpol = 1;
+    p->pol[0] = &policies[2];       // FIFO
+    p->tau = 1000;
+    p->threads = 4;
+    p->outfile = NULL;
+    p->checkfile = p->basefile = NULL;
+    p->tolerance = 10;
+
+    for (i=1, ok=1; i<argc; i++)
+        if (parse_option(argv[i],p)<0)
+            ok = 0;
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s [options]\n\n", argv[0]);
+
+    fprintf (stderr,
+             "    OPTIONS (lists of values separated by commas;\n"
+             "    numbers also as A-B, A-B:STEP or A-B*FACTOR):\n"
+             "\t--alg=LIST: sorting algorithms (%s)\n"
+             "\t        or all (MER)\n"
+             "\t--init=LIST: initial states (%s) or all (RAN)\n"
+             "\t--size=LIST: # of elements to be sorted (1000)\n"
+             "\t--pagsz=LIST: page sizes (16)\n"
+             "\t--frames=LIST: numbers of frames (32)\n"
+             "\t--policy=LIST: random, lru, fifo, fifo2ch, ws,\n"
+             "\t        pff or all (fifo)\n"
+             "\t--tau=N: WS window / PFF threshold (1000)\n"
+             "\t--threads=N: threads of the pool (4)\n"
+             "\t--out=FILE: CSV file with the results (stdout)\n"
+             "\t--check=FILE: fail unless the results are those\n"
+             "\t        of FILE (a previous --out)\n"
+             "\t--baseline=FILE: fail if a policy simulates fewer\n"
+             "\t        references per second than in FILE...\n"
+             "\t--tolerance=PCT: ...by more than PCT %% (10)\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s --alg=all --init=all --size=10,100,1000 \\\n"
+             "\t    --pagsz=1-64*2 --frames=1-32 --policy=all "
+             "--out=sweep.csv\n"
+             "\n",
+             argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok, n;
+    size_t u;
+    const char * s;
+
+    if (!strncmp(arg,"--alg=",6))
+        ok = (p->numalg = parse_names(arg+6,p->alg,8,
+                                      VALID_ALGORITHMS)) > 0;
+    else if (!strncmp(arg,"--init=",7))
+        ok = (p->numinit = parse_names(arg+7,p->init,3,
+                                       VALID_INIT_ORD)) > 0;
+    else if (!strncmp(arg,"--size=",7))
+        ok = (p->numsizes = parse_numbers(arg+7,p->sizes,2)) > 0;
+    else if (!strncmp(arg,"--pagsz=",8))
+        ok = (p->numpagsz = parse_numbers(arg+8,p->pagsz,1)) > 0;
+    else if (!strncmp(arg,"--frames=",9))
+        ok = (p->numframes = parse_numbers(arg+9,p->frames,1)) > 0;
+    else if (!strncmp(arg,"--policy=",9))
+    {
+        s = arg+9;
+        ok = 1;
+
+        if (!strcmp(s,"all"))
+            for (p->numpol=0; p->numpol<NUM_POLICIES; p->numpol++)
+                p->pol[p->numpol] = &policies[p->numpol];
+        else
+            for (p->numpol=0; ok && *s; s+=n+(s[n]==','))
+            {
+                n = strcspn (s, ",");
+
+                for (u=0; u<NUM_POLICIES; u++)
+                    if (strlen(policies[u].name)==n &&
+                        !strncmp(policies[u].name,s,n))
+                        break;
+
+                ok = u<NUM_POLICIES && p->numpol<NUM_POLICIES;
+
+                if (ok)
+                    p->pol[p->numpol++] = &policies[u];
+            }
+
+        ok = ok && p->numpol>0;
+    }
+    else if (!strncmp(arg,"--tau=",6))
+        ok = sscanf(arg+6,"%u",&p->tau)==1 && p->tau>0;
+    else if (!strncmp(arg,"--threads=",10))
+        ok = sscanf(arg+10,"%d",&p->threads)==1 &&
+             p->threads>0 && p->threads<=256;
+    else if (!strncmp(arg,"--out=",6))
+        ok = *(p->outfile = arg+6) != 0;
+    else if (!strncmp(arg,"--check=",8))
+        ok = *(p->checkfile = arg+8) != 0;
+    else if (!strncmp(arg,"--baseline=",11))
+        ok = *(p->basefile = arg+11) != 0;
+    else if (!strncmp(arg,"--tolerance=",12))
+        ok = sscanf(arg+12,"%lf",&p->tolerance)==1 &&
+             p->tolerance>=0 && p->tolerance<100;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
@@ -0,0 +1,303 @@
+/*
+    Copyright 2023 The Operating System Group at the UAH
+    sim_pag_ws.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./sim_paging.h"
+
+// Working set (WS) policy with a window of S->tau references.
+// The process only keeps the pages referenced during the last
+// tau references, so its resident set grows and shrinks over
+// time; numframes is just the size of the physical memory.
+// Pages are never loaded ahead (--prefetch is rejected), since
+// the window only holds pages that have been referenced.
+
+static void release_frame(ssystem* S, int frame);
+static void trim_working_set(ssystem* S, int page);
+
+// Function that initialises the tables
+
+void init_tables(ssystem* S) {
+  int i;
+
+  // Reset pages
+  memset(S->pgt, 0, sizeof(spage) * S->numpags);
+
+  // Empty LRU stack
+  S->lru = -1;
+
+  // Reset LRU(t) time
+  S->clock = 0;
+
+  // Circular list of free frames
+  for (i = 0; i < S->numframes - 1; i++) {
+    S->frt[i].page = -1;
+    S->frt[i].next = i + 1;
+  }
+
+  S->frt[i].page = -1;  // Now i == numframes-1
+  S->frt[i].next = 0;   // Close circular list
+  S->listfree = i;      // Point to the last one
+
+  // Empty circular list of occupied frames
+  S->listoccupied = -1;
+
+  // Empty window: the page referenced at time t is kept in
+  // window[t % tau] until it leaves the window
+  S->window = (int*) malloc(S->tau * sizeof(int));
+
+  if (!S->window) {
+    fprintf(stderr, "ERROR: not enough dynamic memory\n");
+    S->initerror = 1;
+    return;
+  }
+
+  if (S->prefetch.depth) {
+    fprintf(stderr, "ERROR: WS doesn't load pages ahead (--prefetch)\n");
+    S->initerror = 1;
+    return;
+  }
+
+  for (i = 0; i < S->tau; i++) S->window[i] = -1;
+
+  S->numresident = S->maxresident = 0;
+  S->spacetime = 0;
+}
+
+// Functions that simulate the hardware of the MMU
+
+unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
+  unsigned physical_addr;
+  int page, frame, offset;
+
+  page = virtual_addr / S->pagsz;
+  offset = virtual_addr % S->pagsz;
+
+  if (page < 0 || page >= S->numpags) {
+    S->numillegalrefs++;
+    return ~0U;
+  }
+
+  if (!S->pgt[page].present) handle_page_fault(S, virtual_addr);
+
+  frame = S->pgt[page].frame;
+  physical_addr = frame * S->pagsz + offset;
+
+  reference_page(S, page, op);
+
+  if (S->detailed)
+    sim_event(S, EV_ACCESS, op, virtual_addr, frame, 0);
+
+  // The OS drops the page that has just left the window
+  trim_working_set(S, page);
+
+  S->spacetime += S->numresident;
+
+  return physical_addr;
+}
+
+void reference_page(ssystem* S, int page, char op) {
+  if (op == 'R') {              // If it's a read,
+    S->numrefsread++;           // count it
+  } else if (op == 'W') {       // If it's a write,
+    S->pgt[page].modified = 1;  // count it and mark the
+    S->numrefswrite++;          // page 'modified'
+  }
+
+  S->pgt[page].timestamp = S->clock;  // Virtual time of the
+  S->clock++;                         // last reference
+
+  if (S->clock == 0 && S->detailed)
+    sim_event(S, EV_CLOCK, 0, 0, 0, 0);
+}
+
+// Functions that simulate the operating system
+
+void handle_page_fault(ssystem* S, unsigned virtual_address) {
+  int page, victim, frame, last;
+
+  S->numpagefaults++;
+  page = virtual_address / S->pagsz;
+
+  if (S->detailed) sim_event(S, EV_FAULT, 0, page, 0, 0);
+
+  pageout_daemon(S);
+
+  if (S->listfree != -1) {
+    // There are free frames
+    last = S->listfree;
+    frame = S->frt[last].next;
+
+    if (frame == last)
+      S->listfree = -1;  // This is the last one left
+    else
+      S->frt[last].next = S->frt[frame].next;  // Bypass
+
+    occupy_free_frame(S, frame, page);
+  } else {
+    // The working set doesn't fit in physical memory
+    PROFILE_START(S, policymark);
+    victim = choose_page_to_be_replaced(S);
+    PROFILE_STOP(S, policymark, PROF_CHOOSE);
+    replace_page(S, victim, page);
+  }
+}
+
+int choose_page_to_be_replaced(ssystem* S) {
+  int frame, victim, f;
+
+  // Only reached when the working set is larger than the
+  // physical memory: fall back to LRU inside the window
+  for (frame = 0, f = 1; f < S->numframes; f++)
+    if (S->pgt[S->frt[f].page].timestamp <
+        S->pgt[S->frt[frame].page].timestamp)
+      frame = f;
+
+  victim = S->frt[frame].page;
+
+  if (S->detailed)
+    sim_event(S, EV_CHOOSE, 'W', victim, frame, 0);
+
+  return victim;
+}
+
+void replace_page(ssystem* S, int victim, int newpage) {
+  int frame;
+
+  frame = S->pgt[victim].frame;
+
+  if (S->pgt[victim].modified) {
+    if (S->detailed)
+      sim_event(S, EV_WRITEBACK, 0, victim, 0, 0);
+
+    swap_write(S, victim);
+    S->numpgwriteback++;
+  }
+
+  if (S->detailed)
+    sim_event(S, EV_REPLACE, 0, victim, newpage, frame);
+
+  huge_evicted(S, victim);
+
+  S->pgt[victim].present = 0;
+
+  S->pgt[newpage].present = 1;
+  S->pgt[newpage].frame = frame;
+  S->pgt[newpage].modified = 0;
+
+  S->frt[frame].page = newpage;
+
+  swap_read(S, newpage);
+}
+
+void occupy_free_frame(ssystem* S, int frame, int page) {
+  if (S->detailed) sim_event(S, EV_STORE, 0, page, frame, 0);
+
+  S->pgt[page].frame = frame;
+  S->pgt[page].present = 1;
+  S->pgt[page].modified = 0;
+
+  S->frt[frame].page = page;
+
+  swap_read(S, page);
+
+  if (++S->numresident > S->maxresident) S->maxresident = S->numresident;
+}
+
+// Takes the page out of its frame (writing it back if needed)
+// and puts the frame at the end of the list of free frames
+
+static void release_frame(ssystem* S, int frame) {
+  int page = S->frt[frame].page;
+
+  if (S->pgt[page].modified) {
+    if (S->detailed) sim_event(S, EV_WRITEBACK, 1, page, 0, 0);
+
+    swap_write(S, page);
+    S->numpgwriteback++;
+  }
+
+  if (S->detailed) sim_event(S, EV_RELEASE, 0, page, frame, 0);
+
+  huge_evicted(S, page);
+
+  S->pgt[page].present = 0;
+  S->frt[frame].page = -1;
+
+  if (S->listfree == -1) {
+    S->frt[frame].next = frame;
+  } else {
+    S->frt[frame].next = S->frt[S->listfree].next;
+    S->frt[S->listfree].next = frame;
+  }
+
+  S->listfree = frame;
+  S->numresident--;
+}
+
+// Called after the reference number t = S->clock-1 to 'page':
+// the page referenced at t-tau leaves the window, and is
+// released unless it has been referenced again since then
+
+static void trim_working_set(ssystem* S, int page) {
+  unsigned t = S->clock - 1;
+  int slot = t % S->tau;
+  int old = S->window[slot];
+
+  if (old != -1 && S->pgt[old].present && S->pgt[old].timestamp == t - S->tau)
+    release_frame(S, S->pgt[old].frame);
+
+  S->window[slot] = page;
+}
+
+// Functions that show results
+
+void print_page_table(ssystem* S) {
+  int p;
+
+  printf("%10s %10s %10s %10s  %10s\n", "PAGE", "Present", "Frame", "Modified",
+         "Timestamp");
+
+  for (p = 0; p < S->numpags; p++)
+    if (S->pgt[p].present)
+      printf("%8d   %6d     %8d   %6d  %6u\n", p, S->pgt[p].present,
+             S->pgt[p].frame, S->pgt[p].modified, S->pgt[p].timestamp);
+    else
+      printf("%8d   %6d     %8s   %6s  %6s\n", p, S->pgt[p].present, "-", "-",
+             "-");
+}
+
+void print_frames_table(ssystem* S) {
+  int p, f;
+
+  printf("%10s %10s %10s   %s\n", "FRAME", "Page", "Present", "Modified");
+
+  for (f = 0; f < S->numframes; f++) {
+    p = S->frt[f].page;
+
+    if (p == -1)
+      printf("%8d   %8s   %6s     %6s\n", f, "-", "-", "-");
+    else if (S->pgt[p].present)
+      printf("%8d   %8d   %6d     %6d\n", f, p, S->pgt[p].present,
+             S->pgt[p].modified);
+    else
+      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, S->pgt[p].present,
+             "-");
+  }
+}
+
+void print_replacement_report(ssystem* S) {
+  unsigned refs = S->numrefsread + S->numrefswrite;
+
+  printf(
+      "Working set replacement (tau = %u references)\n"
+      "Resident set size:       %d (peak %d of %d frames)\n"
+      "Average resident set:    %.2f frames\n"
+      "Space-time product:      %llu frame-references\n",
+      S->tau, S->numresident, S->maxresident, S->numframes,
+      refs ? S->spacetime / (double)refs : 0.0, S->spacetime);
+}
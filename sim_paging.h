@@ -5,6 +5,9 @@
 #ifndef _SIM_PAGING_H_
 #define _SIM_PAGING_H_
 
+#include <stdio.h>
+#include <stdlib.h>
+
 // Structure that holds the state of a page,
 // simulating an entry of the page table
 
@@ -24,6 +27,9 @@ typedef struct
     //       ---and not in sframe--- because they simulate
     //       a mechanism that, in reality, would be
     //       supported by the hardware.
+
+    // For prefetching
+    char prefetched;    // 1 = loaded ahead, not referenced yet
 }
 spage;
 
@@ -39,6 +45,208 @@ typedef struct
 }
 sframe;
 
+// Structure that holds the state of the swap device and of
+// the pageout daemon (only used if enabled). Times are in ns
+
+typedef struct
+{
+    char enabled;          // 1 = simulate the cost of the I/O
+    unsigned memlat;       // Cost of a memory reference
+    unsigned readlat;      // Latency of a read from the device
+    unsigned writelat;     // Latency of a write to the device
+    unsigned bandwidth;    // Transfer rate of the device (MB/s)
+    int watermark;         // The pageout daemon cleans pages when
+                           // there are fewer free frames than this
+    int cluster;           // Max. pages per clustered write
+
+    int * slot;            // Swap slot of each page (-1 = none)
+    int nextslot;          // Next slot to be allocated (= in use)
+    int hand;              // Next frame the daemon will look at
+
+    unsigned long long now;        // Simulated time
+    unsigned long long busyuntil;  // The device is busy until...
+    unsigned long long stall;      // Time waiting for the device
+    int numreads;          // Pages read in
+    int numwrites;         // Pages written out by page faults
+    int numcleaned;        // Pages written out by the daemon
+    int numclusters;       // Clustered writes of the daemon
+}
+sswap;
+
+// Structure that holds the state of the prefetcher, which
+// follows up to PREFETCH_STREAMS sequential or strided streams
+// of page faults (only used if depth>0)
+
+#define PREFETCH_STREAMS 4
+#define PREFETCH_MAX_DEPTH 64    // Max. pages loaded ahead
+#define PREFETCH_MAX_STRIDE 16   // Max. pages between faults
+
+typedef struct
+{
+    int depth;             // Pages loaded ahead of a stream
+    int last[PREFETCH_STREAMS];     // Last page of each stream
+    int stride[PREFETCH_STREAMS];   // Distance between faults
+    unsigned age[PREFETCH_STREAMS]; // Last fault in the stream
+    unsigned numfaults;    // Faults seen by the prefetcher
+
+    int numissued;         // Pages loaded ahead
+    int numused;           // ... and referenced afterwards
+    int numevicted;        // ... and evicted without being used
+}
+sprefetch;
+
+// Structure that holds the state of the huge pages (only used
+// if factor>0). An aligned region of 'factor' base pages whose
+// pages are all present is collapsed into a huge page by a
+// promoter that works like khugepaged (it looks at 'scan'
+// regions every 'period' references), and it is split back into
+// base pages when the policy evicts one of them. The same TLB
+// is simulated with base pages only (0) and with huge pages (1)
+
+#define HUGE_TLB_MAX 1024        // Max. entries of the TLB
+
+typedef struct
+{
+    int factor;            // Base pages per huge page
+    int tlbsize;           // Entries of the TLB
+    unsigned period;       // References between promoter passes
+    int scan;              // Regions looked at in each pass
+
+    int numregions;        // Whole regions in the address space
+    char * promoted;       // 1 = region mapped by a huge page
+    char * touched;        // 1 = page referenced since promoted
+    int hand;              // Next region the promoter looks at
+    unsigned countdown;    // References until the next pass
+
+    int tlb[2][HUGE_TLB_MAX];    // Entries: 2*page or 2*region+1
+    unsigned long long tlbused[2][HUGE_TLB_MAX];  // Last use
+    int tlbreach[2];       // Base pages mapped by the TLB
+    unsigned long long tlbmisses[2];
+
+    int numhuge, maxhuge;  // Huge pages now and at the peak
+    int numpromoted;       // Collapses
+    int numsplit;          // Splits (on evictions)
+    int cold;              // Pages of huge pages not touched yet
+    unsigned long long numrefs;     // References seen
+    unsigned long long reachsum[2]; // Sum of tlbreach per ref.
+    unsigned long long coldsum;     // Sum of cold per ref.
+}
+shuge;
+
+// Structure that writes a time series of the simulation: one
+// line every 'interval' references, with the references, page
+// faults and write-backs of the interval and the resident and
+// dirty pages at its end (only used if file!=NULL)
+
+typedef struct
+{
+    FILE * file;
+    unsigned interval;     // References per line
+    unsigned countdown;    // References until the next line
+    unsigned long long position;   // References before the line
+    int refs, faults, writebacks;  // Counters when it started
+}
+sseries;
+
+// Phases of the profiler (make PROFILE=1, --profile). Without
+// SIM_PROFILE the macros are empty and nothing is measured
+
+enum
+{
+    PROF_TRACE,     // Reading the trace
+    PROF_HIT,       // sim_mmu without a page fault
+    PROF_FAULT,     // sim_mmu with a page fault
+    PROF_CHOOSE,    // Choosing the victim (part of PROF_FAULT)
+    PROF_REPORT,    // Printing the report
+    PROF_NUMPHASES
+};
+
+typedef struct
+{
+    unsigned long long ticks[PROF_NUMPHASES];  // Time in the phase
+    unsigned long long count[PROF_NUMPHASES];  // Times measured
+    unsigned long long mark, policymark;       // Start of a phase
+    unsigned long long totalticks;             // Whole run
+    double ticksperns;     // Speed of the clock
+}
+sprofile;
+
+#ifdef SIM_PROFILE
+
+// Time stamp counter of x86 (or nanoseconds elsewhere)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define profile_ticks() __rdtsc ()
+#else
+#include <time.h>
+static inline unsigned long long profile_ticks (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1000000000ULL + t.tv_nsec;
+}
+#endif
+
+#define PROFILE_START(S,m) ((S)->prof.m = profile_ticks ())
+#define PROFILE_STOP(S,m,phase) \
+    ((S)->prof.ticks[phase] += profile_ticks () - (S)->prof.m, \
+     (S)->prof.count[phase] ++)
+
+#else
+
+#define PROFILE_START(S,m) ((void) 0)
+#define PROFILE_STOP(S,m,phase) ((void) 0)
+
+#endif // SIM_PROFILE
+
+// Events of the detailed mode. Every event is kept in a
+// fixed-size record, so they can be written to a binary log
+// (--events=FILE) and rendered as text later (sim_pag_decode)
+
+enum
+{
+    EV_ACCESS,      // flag=op, a=address, b=frame
+    EV_FAULT,       // a=page
+    EV_CHOOSE,      // flag=policy, a=victim, b=frame, c=timestamp
+    EV_WRITEBACK,   // flag=1 if the frame is released, a=page
+    EV_REPLACE,     // a=victim, b=new page, c=frame
+    EV_STORE,       // a=page, b=frame
+    EV_RELEASE,     // a=page, b=frame
+    EV_CLOCK,       // flag='N' if timestamps are normalized
+    EV_PFF,         // a=refs since last fault, b=1 if shrinking
+    EV_CLEAN,       // a=page, b=frame
+    EV_PREFETCH,    // a=pages, b=stride
+    EV_UNUSED,      // a=page
+    EV_PROMOTE,     // a=first page of the region, b=pages
+    EV_SPLIT,       // a=first page of the region, b=evicted page
+    EV_NUMTYPES
+};
+
+typedef struct
+{
+    unsigned char type;
+    char flag;
+    short unused;
+    int a, b, c;
+}
+sevent;
+
+struct sevlog;
+
+// Filter of the detailed mode: only events of the types in
+// 'types' (bit 1<<EV_...) that concern pages in [firstpage,
+// lastpage] are shown (if 'on')
+
+typedef struct
+{
+    char on;
+    unsigned types;
+    int firstpage, lastpage;
+}
+sevfilter;
+
 // Structure that contains the state of the whole system
 
 typedef struct
@@ -63,9 +271,96 @@ typedef struct
     int numpgwriteback;    // Counter of write back (to disc) ops.
     int numillegalrefs;    // References out of range
     char detailed;         // 1 = show step-by-step information
+    struct sevlog * evlog; // Binary log of the events (or NULL)
+    sevfilter evfilter;    // Events shown in detailed mode
+
+    // Variable allocation (WS and PFF only)
+    unsigned tau;          // WS window / PFF inter-fault threshold
+    int * window;          // Pages of the last tau references (WS)
+    char initerror;        // 1 = init_tables failed (and said why)
+    unsigned lastfault;    // Time of the last page fault (PFF)
+    int numresident;       // Frames currently given to the process
+    int maxresident;       // Peak of numresident
+    unsigned long long spacetime;  // Sum of numresident per ref.
+
+    // Backing store
+    sswap swap;
+
+    // Prefetching on page faults
+    sprefetch prefetch;
+
+    // Huge pages and TLB
+    shuge huge;
+
+    // Sampling of pages (only a fraction of the pages is simulated,
+    // with proportionally fewer frames)
+    double samplerate;     // 0 = every page is simulated
+    unsigned long long numskipped;  // References to other pages
+    int * sampledpage;     // Page of each simulated one (or NULL)
+    int totalpags;         // Pages of the whole address space
+
+    // Report: references and page faults of each page
+    unsigned * pagerefs;
+    unsigned * pagefaults;
+    char showtables;       // 1 = print the page and frame tables
+    int topn;              // Pages in the top-N lists
+    sseries series;        // Time series of the simulation
+
+    // Time spent in each phase (only with SIM_PROFILE)
+    sprofile prof;
+
+    // Random replacement: a generator per system, so that many
+    // systems can be simulated at once
+    struct random_data randomdata;
+    char randomstate[128];
 }
 ssystem;
 
+// Position in the trace where a checkpoint was taken
+
+typedef struct
+{
+    unsigned totelem;              // Size of the trace (header T)
+    char algorithm[4];             // Parameters of gen_trace
+    char initialstate[4];
+    int numelem;
+    unsigned long long numrefs;    // References already simulated
+    long offset;                   // Byte offset in the trace file
+                                   // (-1 = read from gen_trace)
+}
+sckptpos;
+
+// A program that holds several policies (sim_pag_sweep) builds
+// each of them with -DPOLICY=name, which adds the prefix name_ to
+// the functions that every policy defines
+
+#ifdef POLICY
+#define POLICY_NAME2(p,f) p##_##f
+#define POLICY_NAME(p,f) POLICY_NAME2(p,f)
+#define init_tables POLICY_NAME(POLICY,init_tables)
+#define sim_mmu POLICY_NAME(POLICY,sim_mmu)
+#define reference_page POLICY_NAME(POLICY,reference_page)
+#define handle_page_fault POLICY_NAME(POLICY,handle_page_fault)
+#define choose_page_to_be_replaced \
+        POLICY_NAME(POLICY,choose_page_to_be_replaced)
+#define replace_page POLICY_NAME(POLICY,replace_page)
+#define occupy_free_frame POLICY_NAME(POLICY,occupy_free_frame)
+#define print_page_table POLICY_NAME(POLICY,print_page_table)
+#define print_frames_table POLICY_NAME(POLICY,print_frames_table)
+#define print_replacement_report \
+        POLICY_NAME(POLICY,print_replacement_report)
+#endif
+
+// Entry points of a policy, for the programs that hold several
+
+typedef struct
+{
+    const char * name;
+    void (* init_tables) (ssystem * S);
+    unsigned (* sim_mmu) (ssystem * S, unsigned virt_address, char op);
+}
+spolicy;
+
 // Function that initializes the tables
 
 void init_tables (ssystem * S);
@@ -82,12 +377,66 @@ int choose_page_to_be_replaced (ssystem * S);
 void replace_page (ssystem * S, int victim, int newpage);
 void occupy_free_frame (ssystem * S, int frame, int page);
 
+// Functions that simulate the swap device (sim_pag_swap.c)
+
+void swap_read (ssystem * S, int page);
+void swap_write (ssystem * S, int page);
+void pageout_daemon (ssystem * S);
+
+// Functions that decide what to prefetch (sim_pag_prefetch.c)
+
+int prefetch_candidates (ssystem * S, int page, int cand[]);
+void prefetch_loaded (ssystem * S, int page);
+void prefetch_used (ssystem * S, int page);
+void prefetch_evicted (ssystem * S, int page);
+
+// Functions that model huge pages (sim_pag_huge.c)
+
+int huge_init (ssystem * S);
+void huge_reference (ssystem * S, int page);
+void huge_evicted (ssystem * S, int page);
+void huge_free (ssystem * S);
+
+// Functions that save the whole state of the system to a file
+// and restore it (sim_pag_ckpt.c)
+
+int save_checkpoint (ssystem * S, const char * file,
+                     const sckptpos * pos);
+int load_checkpoint (ssystem * S, const char * file,
+                     sckptpos * pos);
+
+// Functions of the detailed mode (sim_pag_events.c)
+
+void sim_event (ssystem * S, int type, int flag, int a, int b, int c);
+int open_event_log (ssystem * S, const char * file);
+int close_event_log (ssystem * S);
+int parse_event_types (const char * list, unsigned * types);
+void print_event (FILE * f, const sevent * e, int pagsz);
+
+// Number of page p in the address space (in a sampled run the
+// tables only hold the pages of the sample, in order)
+
+static inline int page_number (const ssystem * S, int p)
+{
+    return S->sampledpage && p>=0 ? S->sampledpage[p] : p;
+}
+
 // Functions that show results
 
 void print_report (ssystem * S);
 void print_page_table (ssystem * S);
 void print_frames_table (ssystem * S);
 void print_replacement_report (ssystem * S);
+void print_swap_report (ssystem * S);
+void print_prefetch_report (ssystem * S);
+void print_huge_report (ssystem * S);
+void print_sampling_report (ssystem * S);
+void print_pages_report (ssystem * S);
+int write_report (ssystem * S, const char * file, char format);
+int open_series (ssystem * S, const char * file, unsigned interval);
+void series_point (ssystem * S);
+int close_series (ssystem * S);
+void print_profile_report (ssystem * S);
 
 #endif // _SIM_PAGING_H_
 
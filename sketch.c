@@ -0,0 +1,409 @@
+/*
+    sketch.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sketch.h"
+
+// 64-bit hash of a page number (splitmix64)
+
+static unsigned long long hash64 (unsigned page)
+{
+    unsigned long long x = page + 0x9E3779B97F4A7C15ULL;
+
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Functions of HyperLogLog
+
+int hll_init (shll * H, int p)
+{
+    H->p = p;
+    H->reg = (unsigned char*) calloc (1<<p, 1);
+
+    return H->reg ? 0 : -1;
+}
+
+// The first p bits of the hash choose a register, which keeps
+// the longest run of zeros (+1) seen at the start of the rest
+
+void hll_add (shll * H, unsigned page)
+{
+    unsigned long long x = hash64 (page);
+    int r = x >> (64-H->p), rank = 1;
+
+    for (x <<= H->p; rank <= 64-H->p && !(x>>63); x <<= 1)
+        rank ++;
+
+    if (rank > H->reg[r])
+        H->reg[r] = rank;
+}
+
+double hll_estimate (const shll * H)
+{
+    int m = 1<<H->p, i, zeros = 0;
+    double sum = 0, alpha, e;
+
+    for (i=0; i<m; i++)
+    {
+        sum += ldexp (1, -H->reg[i]);
+        zeros += !H->reg[i];
+    }
+
+    alpha = m==16 ? 0.673 : m==32 ? 0.697 : m==64 ? 0.709 :
+            0.7213/(1+1.079/m);
+    e = alpha*m*m/sum;
+
+    // Few pages: linear counting of the empty registers
+    if (e <= 2.5*m && zeros)
+        e = m*log((double) m/zeros);
+
+    return e;
+}
+
+double hll_error (const shll * H)
+{
+    return 1.04/sqrt(1<<H->p);
+}
+
+void hll_reset (shll * H)
+{
+    memset (H->reg, 0, 1<<H->p);
+}
+
+void hll_free (shll * H)
+{
+    free (H->reg);
+    H->reg = NULL;
+}
+
+// Functions of the map of pages (linear probing, with deletion
+// by moving back the keys that follow)
+
+int keymap_init (skeymap * M, int maxkeys)
+{
+    int i;
+
+    for (M->size=2; M->size < 2*maxkeys; M->size*=2)
+        ;
+
+    M->key = (unsigned*) malloc (M->size*sizeof(unsigned));
+    M->value = (int*) malloc (M->size*sizeof(int));
+
+    if (!M->key || !M->value)
+        return -1;
+
+    for (i=0; i<M->size; i++)
+        M->value[i] = -1;
+
+    return 0;
+}
+
+static int keymap_slot (const skeymap * M, unsigned key)
+{
+    int i = hash64(key) & (M->size-1);
+
+    while (M->value[i]!=-1 && M->key[i]!=key)
+        i = (i+1) & (M->size-1);
+
+    return i;
+}
+
+int keymap_get (const skeymap * M, unsigned key)
+{
+    return M->value[keymap_slot(M,key)];
+}
+
+void keymap_put (skeymap * M, unsigned key, int value)
+{
+    int i = keymap_slot (M, key);
+
+    M->key[i] = key;
+    M->value[i] = value;
+}
+
+void keymap_remove (skeymap * M, unsigned key)
+{
+    int i = keymap_slot (M, key), j, h;
+
+    if (M->value[i]==-1)
+        return;
+
+    for (j=i; ; )
+    {
+        M->value[i] = -1;
+
+        // Move back the next key that can't be found otherwise
+        for (;;)
+        {
+            j = (j+1) & (M->size-1);
+
+            if (M->value[j]==-1)
+                return;
+
+            h = hash64(M->key[j]) & (M->size-1);
+
+            // Can stay if h is cyclically in (i, j]
+            if (i<=j ? (i<h && h<=j) : (i<h || h<=j))
+                continue;
+
+            break;
+        }
+
+        M->key[i] = M->key[j];
+        M->value[i] = M->value[j];
+        i = j;
+    }
+}
+
+void keymap_free (skeymap * M)
+{
+    free (M->key);
+    free (M->value);
+    M->key = NULL;
+    M->value = NULL;
+}
+
+// Functions of SpaceSaving
+
+int spacesaving_init (sspacesaving * S, int k)
+{
+    S->k = k;
+    S->used = 0;
+    S->total = 0;
+    S->page = (unsigned*) malloc (k*sizeof(unsigned));
+    S->count = (unsigned long long*) malloc (k*sizeof(*S->count));
+    S->error = (unsigned long long*) malloc (k*sizeof(*S->error));
+    S->heap = (int*) malloc (k*sizeof(int));
+    S->pos = (int*) malloc (k*sizeof(int));
+
+    if (!S->page || !S->count || !S->error || !S->heap || !S->pos ||
+        keymap_init(&S->map,k)<0)
+        return -1;
+
+    return 0;
+}
+
+// Moves counter heap[i] down while it is greater than a child
+
+static void sift_down (sspacesaving * S, int i)
+{
+    int c, t;
+
+    for (; (c=2*i+1) < S->used; i=c)
+    {
+        if (c+1 < S->used && S->count[S->heap[c+1]] < S->count[S->heap[c]])
+            c ++;
+
+        if (S->count[S->heap[i]] <= S->count[S->heap[c]])
+            break;
+
+        t = S->heap[i];
+        S->heap[i] = S->heap[c];
+        S->heap[c] = t;
+        S->pos[S->heap[i]] = i;
+        S->pos[S->heap[c]] = c;
+    }
+}
+
+// Moves counter heap[i] up while it is smaller than its parent
+
+static void sift_up (sspacesaving * S, int i)
+{
+    int p, t;
+
+    for (; i>0 && S->count[S->heap[i]] < S->count[S->heap[p=(i-1)/2]];
+         i=p)
+    {
+        t = S->heap[i];
+        S->heap[i] = S->heap[p];
+        S->heap[p] = t;
+        S->pos[S->heap[i]] = i;
+        S->pos[S->heap[p]] = p;
+    }
+}
+
+void spacesaving_add (sspacesaving * S, unsigned page)
+{
+    int c = keymap_get (&S->map, page);
+
+    S->total ++;
+
+    if (c==-1 && S->used < S->k)
+    {
+        // A free counter: a new leaf, with count 0 until it is
+        // counted below, so it goes up to the top of the heap
+        c = S->used++;
+        S->heap[c] = c;
+        S->pos[c] = c;
+        S->page[c] = page;
+        S->count[c] = 0;
+        S->error[c] = 0;
+        keymap_put (&S->map, page, c);
+        sift_up (S, c);
+    }
+    else if (c==-1)
+    {
+        // The counter with the smallest count goes to the new page,
+        // which may have had up to that many references
+        c = S->heap[0];
+        keymap_remove (&S->map, S->page[c]);
+        S->page[c] = page;
+        S->error[c] = S->count[c];
+        keymap_put (&S->map, page, c);
+    }
+
+    S->count[c] ++;
+    sift_down (S, S->pos[c]);
+}
+
+static const sspacesaving * sorted_spacesaving;
+
+static int compare_counters (const void * a, const void * b)
+{
+    const sspacesaving * S = sorted_spacesaving;
+    unsigned long long x = S->count[*(const int*)a],
+                       y = S->count[*(const int*)b];
+
+    return x>y ? -1 : x<y;
+}
+
+// Stores in order[] the counters from the largest count down,
+// and returns how many there are
+
+int spacesaving_top (const sspacesaving * S, int order[])
+{
+    int i;
+
+    for (i=0; i<S->used; i++)
+        order[i] = i;
+
+    sorted_spacesaving = S;
+    qsort (order, S->used, sizeof(int), compare_counters);
+
+    return S->used;
+}
+
+void spacesaving_free (sspacesaving * S)
+{
+    free (S->page);
+    free (S->count);
+    free (S->error);
+    free (S->heap);
+    free (S->pos);
+    keymap_free (&S->map);
+}
+
+// Functions of the popularity of the pages
+
+int popularity_init (spopularity * U, int maxpages)
+{
+    U->maxpages = maxpages;
+    U->numpages = 0;
+    U->page = (unsigned*) malloc ((maxpages+1)*sizeof(unsigned));
+    U->count = (unsigned long long*) malloc ((maxpages+1)*
+                                             sizeof(*U->count));
+    U->dropped = (int*) malloc ((maxpages+1)*sizeof(int));
+
+    if (!U->page || !U->count || !U->dropped ||
+        keymap_init(&U->map,maxpages+1)<0 ||
+        sample_init_size(&U->A,maxpages)<0)
+        return -1;
+
+    return 0;
+}
+
+// Takes a page out of the arrays (the last one takes its place)
+
+static void popularity_remove (spopularity * U, unsigned page)
+{
+    int i = keymap_get (&U->map, page), last = --U->numpages;
+
+    keymap_remove (&U->map, page);
+
+    if (i==last)
+        return;
+
+    U->page[i] = U->page[last];
+    U->count[i] = U->count[last];
+    keymap_put (&U->map, U->page[i], i);
+}
+
+void popularity_add (spopularity * U, unsigned page)
+{
+    int i, n;
+
+    if (!sample_wanted(&U->A,page))
+        return;
+
+    i = keymap_get (&U->map, page);
+
+    if (i!=-1)
+    {
+        U->count[i] ++;
+        return;
+    }
+
+    // A new page in the sample, which may push others out
+    i = U->numpages++;
+    U->page[i] = page;
+    U->count[i] = 1;
+    keymap_put (&U->map, page, i);
+
+    n = sample_add (&U->A, page, U->dropped);
+
+    for (i=0; i<n; i++)
+        popularity_remove (U, U->dropped[i]);
+}
+
+static int compare_counts (const void * a, const void * b)
+{
+    unsigned long long x = *(const unsigned long long*) a,
+                       y = *(const unsigned long long*) b;
+
+    return x<y ? -1 : x>y;
+}
+
+// References of the page at quantile q (0..1) of the sample
+// (sorts the counts, so the map is no longer valid)
+
+unsigned long long popularity_quantile (spopularity * U, double q)
+{
+    int i;
+
+    if (!U->numpages)
+        return 0;
+
+    qsort (U->count, U->numpages, sizeof(*U->count), compare_counts);
+
+    i = (int) ceil (q*U->numpages) - 1;
+
+    return U->count[i<0 ? 0 : i];
+}
+
+// Error of the quantiles (in rank, as a fraction of the pages)
+// with the given confidence, from the Dvoretzky-Kiefer-Wolfowitz
+// inequality
+
+double popularity_error (const spopularity * U, double confidence)
+{
+    if (!U->numpages)
+        return 1;
+
+    return sqrt (log(2/(1-confidence)) / (2.0*U->numpages));
+}
+
+void popularity_free (spopularity * U)
+{
+    free (U->page);
+    free (U->count);
+    free (U->dropped);
+    keymap_free (&U->map);
+    sample_free (&U->A);
+}
@@ -0,0 +1,86 @@
+/*
+    sketch.h
+*/
+
+#ifndef _SKETCH_H_
+#define _SKETCH_H_
+
+#include "sample.h"
+
+// Summaries of a stream of page numbers that take a fixed amount
+// of memory, however many pages there are:
+//
+// - HyperLogLog: number of different pages, with a relative
+//   standard error of 1.04/sqrt(2^p) with 2^p registers.
+// - SpaceSaving: the k most referenced pages. Each count is
+//   too high by at most its 'error', and that is at most N/k
+//   after N references; any page with more than N/k references
+//   is in the list.
+// - Popularity: exact number of references of a spatially
+//   hashed sample of the pages (sample.h), from which the
+//   quantiles of the references per page are estimated.
+
+typedef struct
+{
+    int p;                      // 2^p registers
+    unsigned char * reg;
+}
+shll;
+
+int hll_init (shll *, int p);
+void hll_add (shll *, unsigned page);
+double hll_estimate (const shll *);
+double hll_error (const shll *);    // Relative standard error
+void hll_reset (shll *);
+void hll_free (shll *);
+
+// Map from page numbers to 0..size-1 (open addressing)
+
+typedef struct
+{
+    unsigned * key;
+    int * value;                // -1 = empty slot
+    int size;                   // Slots (a power of two)
+}
+skeymap;
+
+int keymap_init (skeymap *, int maxkeys);
+int keymap_get (const skeymap *, unsigned key);
+void keymap_put (skeymap *, unsigned key, int value);
+void keymap_remove (skeymap *, unsigned key);
+void keymap_free (skeymap *);
+
+typedef struct
+{
+    int k, used;
+    unsigned * page;            // Page of each counter
+    unsigned long long * count, * error;
+    int * heap, * pos;          // Min-heap of the counters
+    skeymap map;                // Page -> counter
+    unsigned long long total;   // References seen
+}
+sspacesaving;
+
+int spacesaving_init (sspacesaving *, int k);
+void spacesaving_add (sspacesaving *, unsigned page);
+int spacesaving_top (const sspacesaving *, int order[]);
+void spacesaving_free (sspacesaving *);
+
+typedef struct
+{
+    ssample A;                  // Pages followed (fixed size)
+    int maxpages, numpages;
+    unsigned * page;
+    unsigned long long * count; // References of each page
+    skeymap map;                // Page -> index
+    int * dropped;
+}
+spopularity;
+
+int popularity_init (spopularity *, int maxpages);
+void popularity_add (spopularity *, unsigned page);
+unsigned long long popularity_quantile (spopularity *, double q);
+double popularity_error (const spopularity *, double confidence);
+void popularity_free (spopularity *);
+
+#endif // _SKETCH_H_
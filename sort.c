@@ -377,7 +377,7 @@ static unsigned merge_sort_r (void * p, unsigned size,
                               function_write * pwrite)
 {
     unsigned u, v, w, left, right, iter;
-    thing a, b;
+    thing a = 0, b = 0;
 
     left = size / 2;
     right = size - left;
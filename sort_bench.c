@@ -0,0 +1,498 @@
+/*
+    sort_bench.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sort.h"
+
+// While count_ops counts the operations of the traces, this
+// program measures how long the algorithms of sort.c take to sort
+// real data. The timed runs use callbacks that only read, write
+// and compare, with no counters and no log, so the time left is
+// that of the algorithm and of calling through the pointers of
+// sort.h. Another run, not timed, counts the operations. qsort
+// and std::sort sort the same data, as references of the speed
+// of a native sort
+
+#define MAX_LIST 32     // Max. values of a parameter
+
+// Sorting algorithms, as in gen_trace, and the two references
+
+#define NUM_ALG 10
+#define ALG_QSORT 8
+#define ALG_STD 9
+
+static const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
+                                            "HEA", "COM", "MER",
+                                            "QUI", "QRP", "qsort",
+                                            "std::sort" };
+
+static function_sort * sorts[ALG_QSORT] = { bubble_sort,
+                                             insertion_sort,
+                                             selection_sort, heap_sort,
+                                             comb_sort, merge_sort,
+                                             quick_sort, quick_sort_pa };
+
+// O(N*N) in some initial states (QUI in ASC and DES): only up
+// to --quadratic-max elements
+
+static const char quadratic[NUM_ALG] = { 1, 1, 1, 0, 0, 0, 1, 0, 0, 0 };
+
+#define NUM_INI 3
+
+static const char * initial[NUM_INI] = { "ASC", "DES", "RAN" };
+
+unsigned long long std_sort (thing A[], unsigned size, int count);
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    int numini, numsizes;
+    char want[NUM_ALG];     // Algorithms to measure
+    int ini[NUM_INI];
+    unsigned sizes[MAX_LIST];
+    unsigned quadraticmax;
+    int runs;
+    char csv;
+}
+sparameters;
+
+// Counters of the run that is not timed
+
+typedef struct
+{
+    thing * pdata;
+    unsigned long long nreads, nwrites, ncomparisons;
+}
+scounters;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+// Callbacks of the timed runs: no counters, no log
+
+static thing fast_read (void * p, unsigned pos)
+{
+    return ((thing*) p)[pos];
+}
+
+static void fast_write (void * p, unsigned pos, thing value)
+{
+    ((thing*) p)[pos] = value;
+}
+
+static int fast_lesser_than (void * p, thing a, thing b)
+{
+    return a < b;
+}
+
+// Callbacks of the run that counts
+
+static thing count_read (void * p, unsigned pos)
+{
+    scounters * pc = (scounters*) p;
+
+    pc->nreads ++;
+    return pc->pdata[pos];
+}
+
+static void count_write (void * p, unsigned pos, thing value)
+{
+    scounters * pc = (scounters*) p;
+
+    pc->nwrites ++;
+    pc->pdata[pos] = value;
+}
+
+static int count_lesser_than (void * p, thing a, thing b)
+{
+    ((scounters*) p)->ncomparisons ++;
+    return a < b;
+}
+
+static unsigned long long qsort_comparisons;
+
+static int compare_things (const void * a, const void * b)
+{
+    thing x = *(const thing*) a, y = *(const thing*) b;
+
+    return (x > y) - (x < y);
+}
+
+static int count_compare_things (const void * a, const void * b)
+{
+    qsort_comparisons ++;
+    return compare_things (a, b);
+}
+
+// The same data as gen_trace: 0..size-1 in ascending order, in
+// descending order, or shuffled from the same seed
+
+static void prepare_data (thing A[], unsigned size, int ini)
+{
+    unsigned u, n;
+    thing tmp;
+
+    for (u=0; u<size; u++)
+        A[u] = ini==1 ? size-u-1 : u;
+
+    if (ini!=2)
+        return;
+
+    srand (0);
+
+    for (u=0; u<5; u++)
+        rand ();
+
+    for (u=0; u<size-1; u++)
+    {
+        n = 1 + u + (unsigned)(rand() * (size-u-1.0) / RAND_MAX);
+
+        if (n>size-1)
+            n = size-1;
+
+        if (n!=u)
+        {
+            tmp = A[n];
+            A[n] = A[u];
+            A[u] = tmp;
+        }
+    }
+}
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// Sorts the array with algorithm a, with the fast callbacks (C
+// is NULL) or counting the operations in C
+
+static void run_sort (int a, thing A[], unsigned size, scounters * C)
+{
+    if (a==ALG_QSORT)
+    {
+        qsort_comparisons = 0;
+        qsort (A, size, sizeof(thing),
+               C ? count_compare_things : compare_things);
+
+        if (C)
+            C->ncomparisons = qsort_comparisons;
+    }
+    else if (a==ALG_STD)
+    {
+        if (C)
+            C->ncomparisons = std_sort (A, size, 1);
+        else
+            std_sort (A, size, 0);
+    }
+    else if (C)
+        sorts[a] (C, size, count_lesser_than, count_read, count_write);
+    else
+        sorts[a] (A, size, fast_lesser_than, fast_read, fast_write);
+}
+
+// Best time of P->runs sorts of the same data with algorithm a.
+// Returns -1 if the array doesn't end up sorted
+
+static double time_sort (const sparameters * P, int a, thing A[],
+                         unsigned size, int ini)
+{
+    unsigned u;
+    double t, best = 0;
+    int r;
+
+    for (r=0; r<P->runs; r++)
+    {
+        prepare_data (A, size, ini);
+        t = now ();
+        run_sort (a, A, size, NULL);
+        t = now() - t;
+
+        if (!r || t<best)
+            best = t;
+    }
+
+    for (u=0; u+1<size && A[u]<=A[u+1]; u++)
+        ;
+
+    if (u+1==size)
+        return best;
+
+    fprintf (stderr, "ERROR: %s didn't sort %s %u\n",
+             algorithms[a], initial[ini], size);
+    return -1;
+}
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    scounters C;
+    thing * A;
+    unsigned maxsize, size;
+    int a, i, s, ini, ok = 1;
+    double t, native;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    for (s=0, maxsize=0; s<P.numsizes; s++)
+        if (P.sizes[s]>maxsize)
+            maxsize = P.sizes[s];
+
+    // Twice the size for the temporary array of mergesort
+    A = (thing*) malloc (2*maxsize*sizeof(thing));
+
+    if (!A)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    if (P.csv)
+        printf ("algorithm,initial,size,ns_element,comparisons,"
+                "reads,writes,vs_std_sort\n");
+
+    for (i=0; i<P.numini; i++)
+    {
+        ini = P.ini[i];
+
+        if (!P.csv)
+            printf ("\nInitial state: %s (best of %d runs)\n"
+                    "==================\n%8s %-9s %10s %14s %14s "
+                    "%14s %8s\n", initial[ini], P.runs, "Size",
+                    "Alg", "ns/elem", "Comparisons", "Reads",
+                    "Writes", "x std");
+
+        for (s=0; s<P.numsizes; s++)
+        {
+            size = P.sizes[s];
+
+            // std::sort first, as the reference of the others
+            native = time_sort (&P, ALG_STD, A, size, ini);
+
+            for (a=0; a<NUM_ALG; a++)
+            {
+                if (!P.want[a])
+                    continue;
+
+                // QUI is only O(N*N) when the data are in order
+                if (quadratic[a] && size>P.quadraticmax &&
+                    (a!=6 || ini!=2))
+                    continue;
+
+                t = a==ALG_STD ? native : time_sort (&P, a, A, size, ini);
+
+                if (t<0)
+                {
+                    ok = 0;
+                    continue;
+                }
+
+                // Another run, not timed, to count the operations
+                memset (&C, 0, sizeof(C));
+                C.pdata = A;
+                prepare_data (A, size, ini);
+                run_sort (a, A, size, &C);
+
+                if (P.csv)
+                    printf ("%s,%s,%u,%.3f,%llu,%llu,%llu,%.3f\n",
+                            algorithms[a], initial[ini], size,
+                            t*1e9/size, C.ncomparisons, C.nreads,
+                            C.nwrites, native>0 ? t/native : 0);
+                else if (a>=ALG_QSORT)
+                    printf ("%8u %-9s %10.2f %14llu %14s %14s %8.2f\n",
+                            size, algorithms[a], t*1e9/size,
+                            C.ncomparisons, "-", "-",
+                            native>0 ? t/native : 0);
+                else
+                    printf ("%8u %-9s %10.2f %14llu %14llu %14llu "
+                            "%8.2f\n", size, algorithms[a],
+                            t*1e9/size, C.ncomparisons, C.nreads,
+                            C.nwrites, native>0 ? t/native : 0);
+            }
+
+            if (!P.csv)
+                printf ("\n");
+        }
+    }
+
+    free (A);
+    return ok ? 0 : -1;
+}
+
+// Function that parses a list of numbers: "A,B,C" or "A-B*M"
+// (from A to B multiplying by M). Returns how many or -1
+
+static int parse_numbers (const char * s, unsigned v[], unsigned min)
+{
+    unsigned a, b, m;
+    int n = 0, len;
+
+    for (;;)
+    {
+        m = 0;
+
+        if (sscanf(s,"%u-%u*%u%n",&a,&b,&m,&len)==3)
+        {
+            if (m<2)
+                return -1;
+        }
+        else if (sscanf(s,"%u%n",&a,&len)==1)
+            b = a;
+        else
+            return -1;
+
+        s += len;
+
+        if (a<min || b<a)
+            return -1;
+
+        for (; a<=b; a = m ? a*m : b+1)
+        {
+            if (n==MAX_LIST)
+                return -1;
+
+            v[n++] = a;
+        }
+
+        if (*s=='\0')
+            return n;
+
+        if (*s++!=',')
+            return -1;
+    }
+}
+
+// Function that looks up a list of names separated by commas
+// (or "all") in a table. Returns how many there are or -1
+
+static int parse_names (const char * s, const char ** table,
+                        int size, int v[])
+{
+    int n = 0, i, len;
+
+    if (!strcmp(s,"all"))
+    {
+        for (i=0; i<size; i++)
+            v[i] = i;
+
+        return size;
+    }
+
+    for (; *s; s += len + (s[len]==','))
+    {
+        len = strcspn (s, ",");
+
+        for (i=0; i<size; i++)
+            if (strlen(table[i])==len && !strncmp(table[i],s,len))
+                break;
+
+        if (i==size || n==size)
+            return -1;
+
+        v[n++] = i;
+    }
+
+    return n ? n : -1;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i;
+
+    // Default parameters
+    for (i=0; i<NUM_ALG; i++)
+        p->want[i] = 1;
+    p->numini = NUM_INI;
+    for (i=0; i<p->numini; i++)
+        p->ini[i] = i;
+    p->numsizes = parse_numbers ("1000-1000000*10", p->sizes, 2);
+    p->quadraticmax = 10000;
+    p->runs = 5;
+    p->csv = 0;
+
+    for (i=1, ok=1; i<argc; i++)
+        if (parse_option(argv[i],p)<0)
+            ok = 0;
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s [options]\n\n", argv[0]);
+
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t--alg=LIST: BUB, INS, SEL, HEA, COM, MER, QUI,\n"
+             "\t        QRP, qsort, std::sort or all (all)\n"
+             "\t--init=LIST: ASC, DES, RAN or all (all)\n"
+             "\t--size=LIST: sizes, as A,B,C or A-B*FACTOR\n"
+             "\t        (1000-1000000*10)\n"
+             "\t--quadratic-max=N: largest size for the O(N*N)\n"
+             "\t        cases (10000)\n"
+             "\t--runs=N: timed runs; the best one counts (5)\n"
+             "\t--csv: write the results as CSV\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLE:\n"
+             "\t%s --alg=MER,QRP --init=RAN --size=100000\n"
+             "\n",
+             argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok, v[NUM_ALG], n, i;
+
+    if (!strncmp(arg,"--alg=",6))
+    {
+        n = parse_names (arg+6, algorithms, NUM_ALG, v);
+        memset (p->want, 0, NUM_ALG);
+
+        for (i=0; i<n; i++)
+            p->want[v[i]] = 1;
+
+        ok = n > 0;
+    }
+    else if (!strncmp(arg,"--init=",7))
+        ok = (p->numini = parse_names(arg+7,initial,NUM_INI,
+                                      p->ini)) > 0;
+    else if (!strncmp(arg,"--size=",7))
+        ok = (p->numsizes = parse_numbers(arg+7,p->sizes,2)) > 0;
+    else if (!strncmp(arg,"--quadratic-max=",16))
+        ok = sscanf(arg+16,"%u",&p->quadraticmax)==1;
+    else if (!strncmp(arg,"--runs=",7))
+        ok = sscanf(arg+7,"%d",&p->runs)==1 && p->runs>0;
+    else if (!strcmp(arg,"--csv"))
+        ok = p->csv = 1;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}
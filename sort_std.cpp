@@ -0,0 +1,31 @@
+/*
+    sort_std.cpp
+*/
+
+#include <algorithm>
+
+extern "C"
+{
+#include "sort.h"
+}
+
+// std::sort on the array of things, as the native reference of
+// the benchmark of sort_bench.c. If 'count' is not 0, it also
+// counts the comparisons (in a run that is not timed)
+
+extern "C" unsigned long long std_sort (thing A[], unsigned size,
+                                        int count)
+{
+    unsigned long long comparisons = 0;
+
+    if (count)
+        std::sort (A, A+size, [&comparisons] (thing a, thing b)
+                   {
+                       comparisons ++;
+                       return a < b;
+                   });
+    else
+        std::sort (A, A+size);
+
+    return comparisons;
+}
@@ -0,0 +1,187 @@
+/*
+    stack_dist.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stack_dist.h"
+
+// Function that reserves the stack for pages 0..numpages-1.
+// maxlive is the number of pages expected in the stack at the
+// same time (the slots grow if there are more). Returns 0 if OK
+
+int stack_dist_init (sstackdist * D, int numpages, int maxlive)
+{
+    if (maxlive<1 || maxlive>numpages)
+        maxlive = numpages;
+
+    D->numpages = numpages;
+    D->size = 2*maxlive + 2;
+    D->top = D->live = 0;
+
+    D->slot = (int*) malloc (numpages*sizeof(int));
+    D->tree = (int*) calloc (D->size+1, sizeof(int));
+    D->owner = (int*) malloc (D->size*sizeof(int));
+
+    if (!D->slot || !D->tree || !D->owner)
+    {
+        stack_dist_free (D);
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    memset (D->slot, -1, numpages*sizeof(int));
+    memset (D->owner, -1, D->size*sizeof(int));
+
+    return 0;
+}
+
+// Adds v to slot i of the Fenwick tree
+
+static void tree_add (sstackdist * D, int i, int v)
+{
+    for (i++; i<=D->size; i+=i&-i)
+        D->tree[i] += v;
+}
+
+// Number of occupied slots below slot i
+
+static int tree_prefix (sstackdist * D, int i)
+{
+    int s = 0;
+
+    for (; i>0; i-=i&-i)
+        s += D->tree[i];
+
+    return s;
+}
+
+// Moves the pages to the lowest slots, keeping their order,
+// and makes room for at least as many references as pages
+
+static int compact (sstackdist * D)
+{
+    int s, n, i, j;
+
+    // Pack the owners down (in stack order)
+    for (s=n=0; s<D->top; s++)
+        if (D->owner[s]!=-1)
+        {
+            D->owner[n] = D->owner[s];
+            D->slot[D->owner[n]] = n;
+            n ++;
+        }
+
+    if (2*n+2 > D->size)
+    {
+        int * owner = (int*) realloc (D->owner, 2*D->size*sizeof(int));
+        int * tree = (int*) realloc (D->tree, (2*D->size+1)*sizeof(int));
+
+        if (owner) D->owner = owner;
+        if (tree) D->tree = tree;
+
+        if (!owner || !tree)
+        {
+            fprintf (stderr, "ERROR: not enough dynamic memory\n");
+            return -1;
+        }
+
+        D->size *= 2;
+    }
+
+    for (s=n; s<D->size; s++)
+        D->owner[s] = -1;
+
+    // Build the tree in O(size): 1 in the first n slots
+    for (i=1; i<=D->size; i++)
+        D->tree[i] = i<=n;
+
+    for (i=1; i<=D->size; i++)
+    {
+        j = i + (i&-i);
+
+        if (j<=D->size)
+            D->tree[j] += D->tree[i];
+    }
+
+    D->top = n;
+    return 0;
+}
+
+unsigned stack_dist_ref (sstackdist * D, int page)
+{
+    int old = D->slot[page];
+    unsigned dist = 0;
+
+    if (old!=-1)
+    {
+        // Pages in the slots above (and including) old
+        dist = D->live - tree_prefix(D,old);
+        tree_add (D, old, -1);
+        D->owner[old] = -1;
+        D->live --;
+    }
+
+    if (D->top==D->size && compact(D)<0)
+        exit (-1);
+
+    D->slot[page] = D->top;
+    D->owner[D->top] = page;
+    tree_add (D, D->top, 1);
+    D->top ++;
+    D->live ++;
+
+    return dist;
+}
+
+// Takes the page out of the stack (as if it had never been
+// referenced)
+
+void stack_dist_remove (sstackdist * D, int page)
+{
+    int old = D->slot[page];
+
+    if (old==-1)
+        return;
+
+    tree_add (D, old, -1);
+    D->owner[old] = -1;
+    D->slot[page] = -1;
+    D->live --;
+}
+
+void stack_dist_reset (sstackdist * D)
+{
+    int s;
+
+    for (s=0; s<D->top; s++)
+        if (D->owner[s]!=-1)
+        {
+            D->slot[D->owner[s]] = -1;
+            D->owner[s] = -1;
+        }
+
+    memset (D->tree, 0, (D->size+1)*sizeof(int));
+    D->top = D->live = 0;
+}
+
+int stack_dist_order (const sstackdist * D, int pages[])
+{
+    int s, n;
+
+    for (s=n=0; s<D->top; s++)
+        if (D->owner[s]!=-1)
+            pages[n++] = D->owner[s];
+
+    return n;
+}
+
+void stack_dist_free (sstackdist * D)
+{
+    free (D->slot);
+    free (D->tree);
+    free (D->owner);
+    D->slot = D->tree = D->owner = NULL;
+}
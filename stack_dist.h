@@ -0,0 +1,48 @@
+/*
+    stack_dist.h
+*/
+
+#ifndef _STACK_DIST_H_
+#define _STACK_DIST_H_
+
+// Structure that computes LRU stack distances: the depth of a
+// page in the LRU stack when it is referenced, i.e. the number
+// of different pages referenced since its last reference (+1).
+// With c frames, LRU has a page fault exactly on the references
+// whose distance is greater than c (or that are the first one).
+//
+// Each reference takes a new slot at the top; a Fenwick tree
+// over the slots counts the pages above the old slot of the
+// page in O(log n). When the slots run out they are compacted
+// in stack order.
+
+typedef struct
+{
+    int numpages;         // Pages of the address space
+    int * slot;           // Slot of each page (-1 = not in stack)
+    int * tree;           // Fenwick tree: 1 in the occupied slots
+    int * owner;          // Page in each slot (-1 = empty)
+    int size;             // Number of slots
+    int top;              // Next slot to be used
+    int live;             // Pages in the stack
+}
+sstackdist;
+
+// Functions that manipulate the stack. stack_dist_ref returns
+// the distance of the reference (1 = top of the stack) or 0 if
+// the page was not in the stack, and moves it to the top
+
+int stack_dist_init (sstackdist *, int numpages, int maxlive);
+unsigned stack_dist_ref (sstackdist *, int page);
+void stack_dist_remove (sstackdist *, int page);
+
+// Functions that empty the stack (without going through the
+// whole address space) and that store in pages[]
+// the pages of the stack from the bottom (least recently used)
+// to the top, returning how many there are
+
+void stack_dist_reset (sstackdist *);
+int stack_dist_order (const sstackdist *, int pages[]);
+void stack_dist_free (sstackdist *);
+
+#endif // _STACK_DIST_H_
@@ -0,0 +1,113 @@
+/*
+    trace.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+// Function that opens the trace, from the file if given or by
+// executing gen_trace otherwise, and reads its header
+
+int trace_open (strace * pT, const char * file,
+                const char * algorithm, const char * initialorder,
+                int numelem)
+{
+    pT->numrefs = 0;
+    pT->ispipe = !file;
+
+    if (file)
+    {
+        sprintf (pT->command, "cat %.90s", file);
+        pT->pf = fopen (file, "r");
+    }
+    else
+    {
+        // Invoke gen_trace and open a pipe to read
+        // its standard output ("r" stands for read)
+        sprintf (pT->command, "./gen_trace %s %s %u",
+                              algorithm, initialorder, numelem);
+        pT->pf = popen (pT->command, "r");
+    }
+
+    if (!pT->pf)
+    {
+        perror (file ? file : "ERROR while starting gen_trace");
+        return -1;
+    }
+
+    // Read total # of elements to be sorted
+    if (fscanf(pT->pf," T %u",&pT->totelem)!=1)
+    {
+        fprintf (stderr, "ERROR: wrong trace header\n");
+        trace_close (pT);
+        return -1;
+    }
+
+    return 0;
+}
+
+int trace_next (strace * pT, char * op, unsigned * element)
+{
+    for (;;)
+    {
+        // Ignore spaces and read one character
+        if (fscanf(pT->pf," %c",op)!=1)
+            return -1;
+
+        if (*op=='R' || *op=='W')          // If R/W, take
+        {                                  // element number
+            if (fscanf(pT->pf,"%u",element)!=1)
+                return -1;
+
+            pT->numrefs ++;
+            return 1;
+        }
+        else if (*op=='S')       // 'S'orted -> end
+            return 0;            // 'C'omparison -> go on
+        else if (*op!='C')       // 'O'ut of order (or
+            return -1;           // something else) -> error
+    }
+}
+
+int trace_close (strace * pT)
+{
+    int r;
+
+    if (!pT->pf)
+        return 0;
+
+    // Wait until gen_trace ends and close
+    r = pT->ispipe ? pclose(pT->pf) : fclose(pT->pf);
+    pT->pf = NULL;
+
+    return r==-1 ? -1 : 0;
+}
+
+long trace_tell (strace * pT)
+{
+    return pT->ispipe ? -1 : ftell(pT->pf);
+}
+
+int trace_seek (strace * pT, unsigned long long numrefs, long offset)
+{
+    char op;
+    unsigned u;
+
+    if (!pT->ispipe && offset>=0)
+    {
+        if (fseek(pT->pf,offset,SEEK_SET)<0)
+            return -1;
+
+        pT->numrefs = numrefs;
+        return 0;
+    }
+
+    // A pipe can't go back: read and drop the references
+    while (pT->numrefs<numrefs)
+        if (trace_next(pT,&op,&u)<=0)
+            return -1;
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+    trace.h
+*/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>
+
+// Structure that holds a trace being read, either from the
+// output of gen_trace or from a file where it was saved
+// (./gen_trace MER RAN 1000 > mer_ran_1000.trace)
+
+typedef struct
+{
+    FILE * pf;                // Trace being read
+    char ispipe;              // 1 = output of gen_trace
+    char command[100];        // Command executed (if ispipe)
+    unsigned totelem;         // Total # of elements (header T)
+    unsigned long long numrefs;   // R/W references read so far
+}
+strace;
+
+// Functions that read a trace. trace_next returns 1 for a
+// reference (R/W), 0 at the end of the trace (S) or -1 if
+// something goes wrong. Comparisons (C) are skipped
+
+int trace_open (strace *, const char * file,
+                const char * algorithm, const char * initialorder,
+                int numelem);
+int trace_next (strace *, char * op, unsigned * element);
+int trace_close (strace *);
+
+// Functions that allow resuming a trace from a given point:
+// trace_tell returns the byte offset in the file (-1 if it is
+// a pipe) and trace_seek goes back to it, or skips references
+// until numrefs if it can't seek
+
+long trace_tell (strace *);
+int trace_seek (strace *, unsigned long long numrefs, long offset);
+
+#endif // _TRACE_H_
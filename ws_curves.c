@@ -0,0 +1,475 @@
+/*
+    ws_curves.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+// Computes in a single pass of the trace the mean working set
+// size s(tau) for many windows tau and page sizes at once
+// (Denning and Schwartz). Each reference at time t keeps its page
+// in the working sets W(t',tau) from t' = t until the next
+// reference to the page, or tau references, or the end of the
+// trace, whichever comes first. So, with g the gap until then,
+//
+//     s(tau) = 1/T * sum over the references of min(g, tau)
+//
+// and only the histogram of the gaps is needed. It is kept in
+// buckets between consecutive windows (count and sum of the
+// gaps), which is all that the formula needs for those windows.
+
+#define MAX_LIST 4096       // Max. values of a parameter
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    const char * algorithm, * initialorder;
+    int numelem;
+
+    // Options (--name=value) that may follow the parameters
+    const char * tracefile;     // Trace saved by gen_trace
+    int numpagsz, numtaus;
+    unsigned pagsz[MAX_LIST], taus[MAX_LIST];
+    char list;                  // 1 = one line per (pagsz, tau)
+}
+sparameters;
+
+// Gaps of the references for one page size. count[b] and sum[b]
+// hold the gaps g with b windows <= g
+
+typedef struct
+{
+    unsigned pagsz, numpages;
+    unsigned long long * last;  // Last reference to each page (1..)
+    unsigned long long * count;
+    double * sum;
+}
+sgaps;
+
+int parse_command (int, char*[], sparameters*);
+int parse_option (const char *, sparameters*);
+
+int reserve_gaps (sgaps *, unsigned pagsz, unsigned numpages,
+                  int numtaus);
+void free_gaps (sgaps *);
+void count_gap (sgaps *, const sparameters *, unsigned long long gap);
+void mean_ws (const sgaps *, const sparameters *,
+              unsigned long long numrefs, double s[]);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    strace T;           // Trace (from gen_trace or from a file)
+    int ok, r, k, j;    // Flags and counters
+    char op;            // Elementary operation ('R'ead, 'W'ri..)
+    unsigned u, page;   // Element, page
+    unsigned long long t;       // Legal references so far
+    sgaps * G;          // Gaps of each page size
+    double * s;         // s(tau) of each page size
+    char name[20];      // Header of a column
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %s %s %i\n",
+            argv[0], P.algorithm, P.initialorder, P.numelem);
+
+    if (trace_open(&T,P.tracefile,P.algorithm,
+                   P.initialorder,P.numelem)<0)
+        return -1;
+
+    printf ("# Executing command:  %s\n", T.command);
+
+    G = (sgaps*) calloc (P.numpagsz, sizeof(sgaps));
+    s = (double*) malloc (P.numpagsz*P.numtaus*sizeof(double));
+    ok = G && s;
+
+    for (k=0; ok && k<P.numpagsz; k++)
+        ok = reserve_gaps (&G[k], P.pagsz[k],
+                           (T.totelem+P.pagsz[k]-1) / P.pagsz[k],
+                           P.numtaus) == 0;
+
+    if (!ok)
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+
+    for (t=0; ok; )
+    {
+        r = trace_next (&T, &op, &u);
+
+        if (r<=0)        // 'S'orted -> end
+        {                // (or something else -> error)
+            ok = r==0;
+            break;
+        }
+
+        if (u>=T.totelem)
+            continue;
+
+        t ++;
+
+        for (k=0; k<P.numpagsz; k++)
+        {
+            page = u / G[k].pagsz;
+
+            if (G[k].last[page])
+                count_gap (&G[k], &P, t - G[k].last[page]);
+
+            G[k].last[page] = t;
+        }
+    }
+
+    if (ok)
+    {
+        // The last reference to each page lasts until the end
+        for (k=0; k<P.numpagsz; k++)
+        {
+            for (page=0; page<G[k].numpages; page++)
+                if (G[k].last[page])
+                    count_gap (&G[k], &P, t+1 - G[k].last[page]);
+
+            mean_ws (&G[k], &P, t, s + k*P.numtaus);
+        }
+
+        printf ("# Mean working set size s(tau), in pages, over %llu "
+                "references\n", t);
+
+        if (P.list)
+        {
+            printf ("#\n#%9s %12s %15s\n#\n", "PAGSZ", "TAU", "MEAN WS");
+
+            for (k=0; k<P.numpagsz; k++)
+            {
+                for (j=0; j<P.numtaus; j++)
+                    printf (" %9u %12u %15.4f\n", P.pagsz[k],
+                            P.taus[j], s[k*P.numtaus+j]);
+
+                printf ("\n");      // Blocks for gnuplot
+            }
+        }
+        else
+        {
+            printf ("#\n#%11s", "TAU");
+
+            for (k=0; k<P.numpagsz; k++)
+            {
+                sprintf (name, "PAGSZ=%u", P.pagsz[k]);
+                printf (" %12s", name);
+            }
+
+            printf ("\n#\n");
+
+            for (j=0; j<P.numtaus; j++)
+            {
+                printf (" %11u", P.taus[j]);
+
+                for (k=0; k<P.numpagsz; k++)
+                    printf (" %12.4f", s[k*P.numtaus+j]);
+
+                printf ("\n");
+            }
+        }
+    }
+
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    for (k=0; G && k<P.numpagsz; k++)
+        free_gaps (&G[k]);
+
+    free (G);
+    free (s);
+
+    return ok ? 0 : -1;
+}
+
+// Functions that manipulate the histograms of gaps
+
+int reserve_gaps (sgaps * G, unsigned pagsz, unsigned numpages,
+                  int numtaus)
+{
+    G->pagsz = pagsz;
+    G->numpages = numpages;
+    G->last = (unsigned long long*) calloc (numpages,
+                                            sizeof(*G->last));
+    G->count = (unsigned long long*) calloc (numtaus+1,
+                                             sizeof(*G->count));
+    G->sum = (double*) calloc (numtaus+1, sizeof(double));
+
+    return G->last && G->count && G->sum ? 0 : -1;
+}
+
+void free_gaps (sgaps * G)
+{
+    free (G->last);
+    free (G->count);
+    free (G->sum);
+    G->last = G->count = NULL;
+    G->sum = NULL;
+}
+
+// Counts a gap in the bucket of the number of windows <= gap
+// (the windows are in increasing order)
+
+void count_gap (sgaps * G, const sparameters * P,
+                unsigned long long gap)
+{
+    int lo = 0, hi = P->numtaus, mid;
+
+    while (lo<hi)
+    {
+        mid = (lo+hi) / 2;
+
+        if (P->taus[mid]<=gap)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+
+    G->count[lo] ++;
+    G->sum[lo] += gap;
+}
+
+// s[j] = mean working set size with window taus[j]: the gaps
+// below it count whole, the others count taus[j]
+
+void mean_ws (const sgaps * G, const sparameters * P,
+              unsigned long long numrefs, double s[])
+{
+    unsigned long long above = 0;
+    double below = 0;
+    int j;
+
+    for (j=0; j<=P->numtaus; j++)
+        above += G->count[j];
+
+    for (j=0; j<P->numtaus; j++)
+    {
+        below += G->sum[j];
+        above -= G->count[j];
+        s[j] = numrefs ? (below + (double) P->taus[j]*above) / numrefs
+                       : 0;
+    }
+}
+
+// Function that parses a list of numbers: "A,B,C", "A-B:S" (from
+// A to B in steps of S) or "A-B*M" (multiplying by M). Returns
+// the number of values or -1
+
+static int parse_numbers (const char * s, unsigned v[], unsigned min)
+{
+    unsigned a, b, step;
+    int n = 0, len;
+    char kind;
+
+    for (;;)
+    {
+        kind = '+';
+        step = 1;
+
+        if (sscanf(s,"%u-%u%n",&a,&b,&len)==2)
+        {
+            if (s[len]==':' || s[len]=='*')
+            {
+                kind = s[len];
+                s += len+1;
+
+                if (sscanf(s,"%u%n",&step,&len)!=1)
+                    return -1;
+            }
+        }
+        else if (sscanf(s,"%u%n",&a,&len)==1)
+            b = a;
+        else
+            return -1;
+
+        s += len;
+
+        if (a<min || b<a || step<1 || (kind=='*' && step<2))
+            return -1;
+
+        for (; a<=b; a = kind=='*' ? a*step : a+step)
+        {
+            if (n==MAX_LIST)
+                return -1;
+
+            v[n++] = a;
+        }
+
+        if (*s=='\0')
+            return n;
+
+        if (*s++!=',')
+            return -1;
+    }
+}
+
+static int compare_unsigned (const void * a, const void * b)
+{
+    unsigned x = *(const unsigned*) a, y = *(const unsigned*) b;
+
+    return x<y ? -1 : x>y;
+}
+
+// Sorts a list of numbers and removes the repeated ones
+
+static int sort_numbers (unsigned v[], int n)
+{
+    int i, m;
+
+    qsort (v, n, sizeof(unsigned), compare_unsigned);
+
+    for (i=m=0; i<n; i++)
+        if (!m || v[i]!=v[m-1])
+            v[m++] = v[i];
+
+    return m;
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
+#define VALID_INIT_ORD "ASC/DES/RAN"
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, i, n;
+
+    // Default parameters
+    p->algorithm = "MER";
+    p->initialorder = "RAN";
+    p->numelem = 1000;
+    p->tracefile = NULL;
+    p->numpagsz = parse_numbers ("1-256*2", p->pagsz, 1);
+    p->numtaus = parse_numbers ("1-1048576*2", p->taus, 1);
+    p->list = 0;
+
+    // Take the options out of argv, so that the remaining
+    // parameters keep their positions
+    for (i=n=1, ok=1; i<argc; i++)
+        if (!strncmp(argv[i],"--",2))
+        {
+            if (parse_option(argv[i],p)<0)
+                ok = 0;
+        }
+        else
+            argv[n++] = argv[i];
+
+    argc = n;
+
+    if (argc>4)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        if (argc>1)
+            p->algorithm = argv[1];
+
+        if (strlen(p->algorithm)!=3 ||
+            strchr(p->algorithm,'/') ||
+            !strstr(VALID_ALGORITHMS,p->algorithm))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->initialorder = argv[2];
+
+        if (strlen(p->initialorder)!=3 ||
+            strchr(p->initialorder,'/') ||
+            !strstr(VALID_INIT_ORD,p->initialorder))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial order");
+            ok = 0;
+        }
+
+        if (argc>3 && (sscanf(argv[3],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+    {
+        p->numpagsz = sort_numbers (p->pagsz, p->numpagsz);
+        p->numtaus = sort_numbers (p->taus, p->numtaus);
+        return 0;
+    }
+
+    fprintf (stderr, "\n\n    USAGE:\n\t%s algorithm initialorder "
+             "numelem\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\talgorithm: sorting algorithm (%s)\n"
+             "\tinitialorder: initial order of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    OPTIONS (lists of values separated by commas;\n"
+             "    numbers also as A-B, A-B:STEP or A-B*FACTOR):\n"
+             "\t--pagsz=LIST: page sizes (1-256*2)\n"
+             "\t--tau=LIST: windows (1-1048576*2)\n"
+             "\t--trace=FILE: read the trace from a file saved\n"
+             "\t        with gen_trace instead of running it\n"
+             "\t--list: one line per page size and window\n"
+             "\t        (for gnuplot) instead of a table\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s MER RAN 1000\n"
+             "\t%s QUI RAN 10000 --pagsz=16 --tau=100-10000:100\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
+
+// Function that parses one option (--name=value) received
+// through the command line:
+
+int parse_option (const char * arg, sparameters * p)
+{
+    int ok;
+
+    if (!strncmp(arg,"--trace=",8))
+        ok = *(p->tracefile = arg+8) != 0;
+    else if (!strncmp(arg,"--pagsz=",8))
+        ok = (p->numpagsz = parse_numbers(arg+8,p->pagsz,1)) > 0;
+    else if (!strncmp(arg,"--tau=",6))
+        ok = (p->numtaus = parse_numbers(arg+6,p->taus,1)) > 0;
+    else if (!strcmp(arg,"--list"))
+        ok = p->list = 1;
+    else
+    {
+        fprintf (stderr,
+                 "\n    ERROR: unknown option %s", arg);
+        return -1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    ERROR: wrong value in %s", arg);
+    return -1;
+}